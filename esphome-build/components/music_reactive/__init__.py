@@ -5,20 +5,132 @@ from esphome.const import CONF_ID
 DEPENDENCIES = ['fastcon']
 
 MusicReactiveEffectUDP = cg.global_ns.class_('MusicReactiveEffectUDP', cg.Component)
+SyncProtocol = cg.global_ns.enum('SyncProtocol')
+SyncTransport = cg.global_ns.enum('SyncTransport')
+MapSource = cg.global_ns.enum('MapSource')
 
 CONF_FASTCON_ID = "fastcon_id"
+CONF_CAPTURE_TASK = "capture_task"
+CONF_FFT_BACKEND = "fft_backend"
+CONF_FFT_SIZE = "fft_size"
+CONF_STREAMING_CAPTURE = "streaming_capture"
+CONF_WINDOW_OVERLAP = "window_overlap"
+CONF_NUM_BANDS = "num_bands"
+CONF_AUTO_GAIN = "auto_gain"
+CONF_BEAT_SYNC = "beat_sync"
+CONF_SEND_THRESHOLD = "send_threshold"
+CONF_KEEPALIVE = "keepalive"
+CONF_SYNC_PROTOCOL = "sync_protocol"
+CONF_PLAYOUT_DELAY = "playout_delay"
+CONF_TRANSPORT = "transport"
+CONF_MULTICAST_GROUP = "multicast_group"
+CONF_UNICAST_TARGETS = "unicast_targets"
+CONF_LIGHT_MAP = "light_map"
+CONF_ADDRESS = "address"
+CONF_SOURCE = "source"
+CONF_HUE = "hue"
+CONF_FIRST_BIN = "first_bin"
+CONF_LAST_BIN = "last_bin"
+CONF_BEAT_SENSITIVITY = "beat_sensitivity"
+
+FFT_BACKENDS = ["arduinofft", "esp_dsp"]
+
+SYNC_PROTOCOLS = {
+    "native": SyncProtocol.SYNC_NATIVE,
+    "wled": SyncProtocol.SYNC_WLED,
+    "legacy": SyncProtocol.SYNC_LEGACY,
+}
+
+SYNC_TRANSPORTS = {
+    "broadcast": SyncTransport.TRANSPORT_BROADCAST,
+    "multicast": SyncTransport.TRANSPORT_MULTICAST,
+    "unicast": SyncTransport.TRANSPORT_UNICAST,
+}
+
+MAP_SOURCES = {
+    "spectrum": MapSource.MAP_SPECTRUM,
+    "bass": MapSource.MAP_BASS,
+    "mid": MapSource.MAP_MID,
+    "treble": MapSource.MAP_TREBLE,
+    "volume": MapSource.MAP_VOLUME,
+}
+
+LIGHT_MAP_SCHEMA = cv.Schema({
+    cv.Required(CONF_ADDRESS): cv.hex_uint16_t,
+    cv.Optional(CONF_SOURCE, default="spectrum"): cv.enum(MAP_SOURCES, lower=True),
+    # Fixed hue in degrees; by default the hue runs red to blue along the table
+    cv.Optional(CONF_HUE): cv.float_range(min=0, max=360),
+    cv.Optional(CONF_FIRST_BIN): cv.int_range(min=0, max=17),
+    cv.Optional(CONF_LAST_BIN): cv.int_range(min=0, max=17),
+})
 
 CONFIG_SCHEMA = cv.Schema({
     cv.GenerateID(): cv.declare_id(MusicReactiveEffectUDP),
     cv.Required(CONF_FASTCON_ID): cv.use_id(cg.esphome_ns.namespace('fastcon').class_('FastconController')),
+    # Run I2S capture + FFT in a FreeRTOS task on the other core instead of in loop()
+    cv.Optional(CONF_CAPTURE_TASK, default=False): cv.boolean,
+    # esp_dsp: float32 FFT on the hardware FPU (arduinoFFT runs in emulated double precision)
+    cv.Optional(CONF_FFT_BACKEND, default="arduinofft"): cv.one_of(*FFT_BACKENDS, lower=True),
+    cv.Optional(CONF_FFT_SIZE, default=256): cv.one_of(256, 512, 1024, int=True),
+    # Continuous DMA capture with overlapping FFT windows instead of one blocking read per frame
+    cv.Optional(CONF_STREAMING_CAPTURE, default=False): cv.boolean,
+    cv.Optional(CONF_WINDOW_OVERLAP, default=0.5): cv.All(cv.percentage, cv.Range(max=0.75)),
+    # Log-spaced spectrum bands sent in the sync packet's fft_bins (max 18)
+    cv.Optional(CONF_NUM_BANDS, default=16): cv.int_range(min=1, max=18),
+    # Per-band automatic gain control with noise-floor tracking instead of a fixed clamp
+    cv.Optional(CONF_AUTO_GAIN, default=True): cv.boolean,
+    # Only send light commands on detected beats (less mesh airtime, tighter pulses)
+    cv.Optional(CONF_BEAT_SYNC, default=False): cv.boolean,
+    # Onset threshold in standard deviations above the recent spectral flux
+    cv.Optional(CONF_BEAT_SENSITIVITY, default=1.5): cv.float_range(min=0.5, max=4.0),
+    # Drop frames whose color moved less than this (redmean distance, 0 = send all)
+    cv.Optional(CONF_SEND_THRESHOLD, default=8.0): cv.float_range(min=0.0, max=765.0),
+    # Resend an unchanged color at least this often
+    cv.Optional(CONF_KEEPALIVE, default="1s"): cv.positive_time_period_milliseconds,
+    # UDP sync format: native (sequenced + timestamped), wled (WLED audio sync v2) or legacy ('AS').
+    # legacy by default, the only one fft_analyzer_udp.h slaves decode; use native once all
+    # slaves run this component, it adds sequencing, beat flags and playout timing
+    cv.Optional(CONF_SYNC_PROTOCOL, default="legacy"): cv.enum(SYNC_PROTOCOLS, lower=True),
+    # Frames are rendered this long after the master analysed them, on every node alike
+    cv.Optional(CONF_PLAYOUT_DELAY, default="60ms"): cv.positive_time_period_milliseconds,
+    # broadcast (subnet), multicast (one group per zone) or unicast to the listed slaves
+    cv.Optional(CONF_TRANSPORT, default="broadcast"): cv.enum(SYNC_TRANSPORTS, lower=True),
+    cv.Optional(CONF_MULTICAST_GROUP, default="239.0.11.98"): cv.string,
+    cv.Optional(CONF_UNICAST_TARGETS, default=[]): cv.ensure_list(cv.string),
+    # Lights for the "Per Light" / "Spectrum" color modes, left to right (max 16).
+    # Spectrum lights without a bin range split the bins evenly between them.
+    cv.Optional(CONF_LIGHT_MAP, default=[]): cv.All(cv.ensure_list(LIGHT_MAP_SCHEMA), cv.Length(max=16)),
 }).extend(cv.COMPONENT_SCHEMA)
 
 async def to_code(config):
-    cg.add_library("https://github.com/kosme/arduinoFFT.git#v1.6.1", None)
+    if config[CONF_FFT_BACKEND] == "esp_dsp":
+        # ESP-DSP ships with the ESP32 Arduino core, no extra library needed
+        cg.add_build_flag("-DMUSIC_FFT_ESP_DSP")
+    else:
+        cg.add_library("https://github.com/kosme/arduinoFFT.git#v1.6.1", None)
+    cg.add_build_flag(f"-DMUSIC_FFT_SAMPLES={config[CONF_FFT_SIZE]}")
     cg.add_global(cg.RawExpression('#include "esphome/components/music_reactive/music_reactive.h" //'))
     
     var = cg.new_Pvariable(config[CONF_ID], True) # True for master mode
     await cg.register_component(var, config)
+    cg.add(var.set_capture_task(config[CONF_CAPTURE_TASK]))
+    cg.add(var.set_num_bands(config[CONF_NUM_BANDS]))
+    cg.add(var.set_streaming_capture(config[CONF_STREAMING_CAPTURE], config[CONF_WINDOW_OVERLAP]))
+    cg.add(var.set_auto_gain(config[CONF_AUTO_GAIN]))
+    cg.add(var.set_beat_sync(config[CONF_BEAT_SYNC]))
+    cg.add(var.set_beat_sensitivity(config[CONF_BEAT_SENSITIVITY]))
+    cg.add(var.set_send_threshold(config[CONF_SEND_THRESHOLD], config[CONF_KEEPALIVE]))
+    cg.add(var.set_sync_protocol(config[CONF_SYNC_PROTOCOL]))
+    cg.add(var.set_playout_delay(config[CONF_PLAYOUT_DELAY]))
+    cg.add(var.set_transport(config[CONF_TRANSPORT]))
+    cg.add(var.set_multicast_group(config[CONF_MULTICAST_GROUP]))
+    for target in config[CONF_UNICAST_TARGETS]:
+        cg.add(var.add_unicast_target(target))
+    for light in config[CONF_LIGHT_MAP]:
+        hue = light[CONF_HUE] / 360.0 if CONF_HUE in light else -1.0
+        first = light.get(CONF_FIRST_BIN, -1)
+        last = light.get(CONF_LAST_BIN, first)
+        cg.add(var.add_light_mapping(light[CONF_ADDRESS], light[CONF_SOURCE], hue, first, last))
     
     fastcon = await cg.get_variable(config[CONF_FASTCON_ID])
     cg.add(var.set_controller(fastcon))
@@ -0,0 +1,753 @@
+#pragma once
+
+/*
+ * Shared audio core for the music effects
+ *
+ * One microphone, one analysis buffer and one set of band sensors per firmware. Effects
+ * and zones are consumers: they read the newest analysed frame from AudioCore::get()
+ * instead of each installing I2S, holding its own FFT arrays and running its own FFT.
+ * A frame is analysed once no matter how many consumers read it.
+ *
+ * Used by the music_reactive component and by the legacy fft_analyzer.h /
+ * fft_analyzer_udp.h headers (listed before them under esphome: includes:).
+ */
+
+#include <atomic>
+#include "esphome.h"
+#include <driver/i2s.h>
+
+// FFT size and backend are selected from the component schema (fft_size / fft_backend)
+#ifndef MUSIC_FFT_SAMPLES
+#define MUSIC_FFT_SAMPLES 256
+#endif
+
+#ifdef MUSIC_FFT_ESP_DSP
+#include "esp_dsp.h"
+#else
+#include "arduinoFFT.h"
+#endif
+
+#define SAMPLES MUSIC_FFT_SAMPLES
+#define SAMPLING_FREQUENCY 22050
+#define I2S_READ_CHUNK 64  // Samples per i2s_read(), keeps the stack small for large FFTs
+#define I2S_DMA_SAMPLES 4096  // Total DMA buffering (~186ms), split into I2S_READ_CHUNK buffers
+#define MAX_SPECTRUM_BANDS 18  // One per fft_bins entry in AudioSyncPacket
+#define SPECTRUM_MIN_HZ 60.0
+#define SPECTRUM_MAX_HZ 9000.0
+#define UDP_PORT 11988  // WLED sound sync port
+#define PROFILE_WINDOW_MS 10000  // Profiling results cover windows of this length
+#define SENSOR_INTERVAL_MS 100   // Band sensors publish at most this often, across all consumers
+
+// Original sync packet: 'A','S' header, no sequence or timestamp
+struct AudioSyncPacket {
+  uint8_t header[2];        // 'A', 'S' (Audio Sync)
+  uint8_t volume;           // Overall volume 0-255
+  uint8_t bass;             // Bass level 0-255
+  uint8_t mid;              // Mid level 0-255
+  uint8_t treble;           // Treble level 0-255
+  uint8_t fft_bins[18];     // Simplified FFT spectrum (18 bins)
+};
+
+// Bin range of one analysis band; `scale` folds the averaging and FFT-size normalisation
+struct BandRange {
+  uint16_t first_bin;
+  uint16_t last_bin;
+  float scale;
+};
+
+// One analysis result, handed from the core to its consumers
+struct AudioLevels {
+  float bass;
+  float mid;
+  float treble;
+  float volume;
+  uint8_t fft_bins[18];
+  uint8_t bin_count;            // Valid entries in fft_bins
+  uint32_t beat_count;
+  float bpm;
+  float peak_magnitude;         // Loudest spectrum band, before gain control
+  float peak_hz;                // Its centre frequency
+};
+
+// Per-frame coefficients for BandAGC, derived from the time since the previous frame
+// so the time constants hold at any analysis rate
+struct AgcRates {
+  float attack;
+  float release;
+  float floor_rise;
+  float floor_fall;
+};
+
+// Automatic gain control for one band. The noise floor is an asymmetric EMA that drops
+// quickly into quiet passages and creeps up slowly; the peak envelope has a fast attack
+// and slow release. The level is rescaled between a gate just above the floor and the
+// peak, so every venue uses the full 0-1 range and silence reads as a steady 0.
+struct BandAGC {
+  static constexpr float ATTACK_S = 0.01;
+  static constexpr float RELEASE_S = 4.0;
+  static constexpr float FLOOR_RISE_S = 20.0;
+  static constexpr float FLOOR_FALL_S = 0.3;
+  static constexpr float NOISE_GATE = 1.4;     // Gate ~3dB above the noise floor
+  static constexpr float MIN_RANGE = 0.02;     // Keeps noise from being stretched to full scale
+
+  float floor = 0.0;
+  float peak = 0.0;
+  bool primed = false;
+
+  static AgcRates rates(float dt) {
+    AgcRates r;
+    r.attack = 1.0f - expf(-dt / ATTACK_S);
+    r.release = 1.0f - expf(-dt / RELEASE_S);
+    r.floor_rise = 1.0f - expf(-dt / FLOOR_RISE_S);
+    r.floor_fall = 1.0f - expf(-dt / FLOOR_FALL_S);
+    return r;
+  }
+
+  float process(float level, const AgcRates &r) {
+    if (!primed) {
+      floor = peak = level;
+      primed = true;
+    }
+    floor += (level < floor ? r.floor_fall : r.floor_rise) * (level - floor);
+    peak += (level > peak ? r.attack : r.release) * (level - peak);
+
+    float gate = floor * NOISE_GATE;
+    if (peak < gate + MIN_RANGE) peak = gate + MIN_RANGE;
+    float out = (level - gate) / (peak - gate);
+    return out < 0.0f ? 0.0f : (out > 1.0f ? 1.0f : out);
+  }
+};
+
+// Spectral-flux onset detector with an adaptive threshold, plus a tempo tracker fed
+// by the inter-onset intervals. Fully incremental: per frame it touches the band
+// levels once and keeps only a ring of recent flux values and running sums.
+struct OnsetDetector {
+  static const int HISTORY = 32;                  // Frames in the rolling threshold window
+  static const uint32_t MIN_ONSET_GAP_MS = 150;   // Refractory period, ~400 BPM max
+  static const uint32_t MAX_BEAT_GAP_MS = 2000;   // Longer gaps restart the tempo estimate
+  static constexpr float MIN_FLUX = 0.02;          // Absolute floor so silence can't trigger
+  static constexpr float MIN_PERIOD_MS = 333.0;    // Tempo estimates are folded into 60-180 BPM
+  static constexpr float MAX_PERIOD_MS = 1000.0;
+
+  float threshold_k = 1.5;        // Onset when flux > mean + k * stddev of the history
+  float prev_levels[MAX_SPECTRUM_BANDS] = {0};
+  float history[HISTORY] = {0};
+  int history_pos = 0;
+  int history_fill = 0;
+  float flux_sum = 0.0;
+  float flux_sq_sum = 0.0;
+
+  uint32_t last_onset = 0;
+  uint32_t beat_count = 0;
+  float beat_period = 0.0;        // Smoothed beat period in ms, 0 until a tempo locks
+  int tempo_misses = 0;           // Consecutive intervals that didn't match the tempo
+
+  // Feed one frame of band levels; true if it starts an onset
+  bool process(const float *levels, int count, uint32_t now) {
+    // Half-wave rectified flux: only rising energy counts
+    float flux = 0.0;
+    for (int b = 0; b < count; b++) {
+      float rise = levels[b] - prev_levels[b];
+      if (rise > 0) flux += rise;
+      prev_levels[b] = levels[b];
+    }
+
+    bool onset = false;
+    if (history_fill == HISTORY) {
+      float mean = flux_sum / HISTORY;
+      float variance = flux_sq_sum / HISTORY - mean * mean;
+      float threshold = mean + threshold_k * sqrtf(variance > 0 ? variance : 0);
+      onset = flux > threshold && flux > MIN_FLUX && now - last_onset >= MIN_ONSET_GAP_MS;
+    }
+
+    // Slide the window; the sums are rebuilt once per wrap so float error can't accumulate
+    if (history_fill == HISTORY) {
+      float oldest = history[history_pos];
+      flux_sum -= oldest;
+      flux_sq_sum -= oldest * oldest;
+    } else {
+      history_fill++;
+    }
+    history[history_pos] = flux;
+    flux_sum += flux;
+    flux_sq_sum += flux * flux;
+    history_pos = (history_pos + 1) % HISTORY;
+    if (history_pos == 0) {
+      flux_sum = flux_sq_sum = 0.0;
+      for (int i = 0; i < history_fill; i++) {
+        flux_sum += history[i];
+        flux_sq_sum += history[i] * history[i];
+      }
+    }
+
+    if (onset) {
+      if (beat_count > 0) track_tempo(now - last_onset);
+      last_onset = now;
+      beat_count++;
+    }
+    return onset;
+  }
+
+  void track_tempo(uint32_t interval_ms) {
+    if (interval_ms > MAX_BEAT_GAP_MS) {
+      beat_period = 0.0;
+      return;
+    }
+    // Off-beats and skipped beats land at half or double the period; fold them back
+    float interval = interval_ms;
+    while (interval < MIN_PERIOD_MS) interval *= 2.0;
+    while (interval > MAX_PERIOD_MS) interval /= 2.0;
+
+    if (beat_period == 0.0 || tempo_misses >= 4) {
+      // No tempo yet, or the music has clearly changed: re-seed
+      beat_period = interval;
+      tempo_misses = 0;
+    } else if (fabsf(interval - beat_period) < beat_period * 0.2) {
+      beat_period += 0.15 * (interval - beat_period);
+      tempo_misses = 0;
+    } else {
+      tempo_misses++;
+    }
+  }
+
+  float bpm() const {
+    return beat_period > 0 ? 60000.0 / beat_period : 0.0;
+  }
+};
+
+// Result of one StageTimer window
+struct StageStats {
+  uint32_t min_us;
+  uint32_t avg_us;
+  uint32_t max_us;
+  uint32_t count;
+};
+
+// Time spent in one pipeline stage, measured with micros(). The window is closed by the
+// writer itself on the first sample after PROFILE_WINDOW_MS. Only the writer touches the
+// running window; the finished one is published like AudioCore's levels (double buffer +
+// sequence, see publish_levels()), so loop() can read a timer fed from the audio task.
+struct StageTimer {
+  uint32_t window_start = 0;
+  uint32_t count = 0;
+  uint64_t total_us = 0;
+  uint32_t min_us = UINT32_MAX;
+  uint32_t max_us = 0;
+  StageStats windows[2] = {};
+  std::atomic<uint32_t> windows_published{0};
+
+  void record(uint32_t us, uint32_t now) {
+    if (now - window_start >= PROFILE_WINDOW_MS) {
+      if (count > 0) {
+        uint32_t next = windows_published.load(std::memory_order_relaxed) + 1;
+        windows[next & 1] = {min_us, (uint32_t)(total_us / count), max_us, count};
+        windows_published.store(next, std::memory_order_release);
+      }
+      count = 0;
+      total_us = 0;
+      min_us = UINT32_MAX;
+      max_us = 0;
+      window_start = now;
+    }
+    count++;
+    total_us += us;
+    if (us < min_us) min_us = us;
+    if (us > max_us) max_us = us;
+  }
+
+  // The last finished window, retried if the writer published another one meanwhile
+  StageStats last() const {
+    uint32_t seq;
+    StageStats stats;
+    do {
+      seq = windows_published.load(std::memory_order_acquire);
+      stats = windows[seq & 1];
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while (windows_published.load(std::memory_order_relaxed) != seq);
+    return stats;
+  }
+};
+
+// Times the enclosing scope into a StageTimer, early returns included
+struct ScopedStageTimer {
+  StageTimer &timer;
+  uint32_t start;
+  explicit ScopedStageTimer(StageTimer &t) : timer(t), start(micros()) {}
+  ~ScopedStageTimer() { timer.record(micros() - start, millis()); }
+};
+
+static inline void hsv_to_rgb(float h, float s, float v, uint8_t &r, uint8_t &g, uint8_t &b) {
+  float c = v * s;
+  float x = c * (1.0 - fabs(fmod(h * 6.0, 2.0) - 1.0));
+  float m = v - c;
+
+  float r_prime, g_prime, b_prime;
+  if (h < 0.166) {
+    r_prime = c; g_prime = x; b_prime = 0;
+  } else if (h < 0.333) {
+    r_prime = x; g_prime = c; b_prime = 0;
+  } else if (h < 0.5) {
+    r_prime = 0; g_prime = c; b_prime = x;
+  } else if (h < 0.666) {
+    r_prime = 0; g_prime = x; b_prime = c;
+  } else if (h < 0.833) {
+    r_prime = x; g_prime = 0; b_prime = c;
+  } else {
+    r_prime = c; g_prime = 0; b_prime = x;
+  }
+
+  r = (uint8_t)((r_prime + m) * 255.0);
+  g = (uint8_t)((g_prime + m) * 255.0);
+  b = (uint8_t)((b_prime + m) * 255.0);
+}
+
+// "Redmean" weighted RGB distance, a cheap approximation of perceived difference
+// that weights the channels by how sensitive the eye is to them at that redness
+static inline float color_distance(const uint8_t *a, const uint8_t *b) {
+  float rmean = (a[0] + b[0]) / 2.0f;
+  float dr = (float)a[0] - b[0];
+  float dg = (float)a[1] - b[1];
+  float db = (float)a[2] - b[2];
+  return sqrtf((2.0f + rmean / 256.0f) * dr * dr + 4.0f * dg * dg +
+               (2.0f + (255.0f - rmean) / 256.0f) * db * db);
+}
+
+// FFT working set, only allocated on nodes that capture (slaves never need it)
+struct AudioAnalysisBuffers {
+#ifdef MUSIC_FFT_ESP_DSP
+  // float32 radix-2 FFT on the ESP32's single-precision FPU. Interleaved re/im,
+  // half the size of the double vReal/vImag pair; magnitudes are written back
+  // in place into the first SAMPLES/2 entries.
+  float fft_data[SAMPLES * 2];
+#else
+  arduinoFFT FFT = arduinoFFT();
+  double vReal[SAMPLES];
+  double vImag[SAMPLES];
+#endif
+
+  // Lookup tables built once; per frame the analysis is just window multiply on
+  // capture and accumulate-and-scale over the band ranges
+  float fft_window[SAMPLES];
+
+  // Streaming capture ring of the newest SAMPLES samples
+  float sample_ring[SAMPLES] = {0};
+};
+
+class AudioCore : public esphome::Component {
+ public:
+  // The firmware's one core, created and registered on first use. Consumers call this
+  // while the config is being built, before App.setup(), so it still gets its setup().
+  static AudioCore *get() {
+    static AudioCore *core = nullptr;
+    if (core == nullptr) {
+      core = new AudioCore();
+      App.register_component(core);
+    }
+    return core;
+  }
+
+  float get_setup_priority() const override { return esphome::setup_priority::DATA; }
+
+  void setup() override {
+    if (!capture_enabled) return;
+
+    // Initialize I2S microphone
+    i2s_config_t i2s_config = {
+      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
+      .sample_rate = SAMPLING_FREQUENCY,
+      .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,
+      .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+      .communication_format = I2S_COMM_FORMAT_I2S,
+      .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+      // Buffers no longer than a hop, so a streamed hop is readable as soon as it is complete
+      .dma_buf_count = I2S_DMA_SAMPLES / I2S_READ_CHUNK,
+      .dma_buf_len = I2S_READ_CHUNK,
+      .use_apll = false,
+      .tx_desc_auto_clear = false,
+      .fixed_mclk = 0
+    };
+
+    i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
+    ESP_LOGI("audio", "Microphone initialized");
+
+    buffers = new AudioAnalysisBuffers();
+    build_analysis_tables();
+#ifdef MUSIC_FFT_ESP_DSP
+    // Twiddle factors are computed once here, not per frame
+    dsps_fft2r_init_fc32(NULL, SAMPLES);
+    ESP_LOGI("audio", "ESP-DSP float FFT, %d points", SAMPLES);
+#else
+    ESP_LOGI("audio", "arduinoFFT double FFT, %d points", SAMPLES);
+#endif
+
+    if (use_capture_task) {
+      // Run on the core ESPHome's loop() isn't on, at low priority so BLE/WiFi still win
+      BaseType_t core = 1 - xPortGetCoreID();
+      xTaskCreatePinnedToCore(capture_task, "music_capture", 4096, this, 1, &capture_task_handle, core);
+      ESP_LOGI("audio", "Audio capture task started on core %d", core);
+    }
+  }
+
+  void loop() override {
+    // Streaming without the task: drain the DMA buffers on every loop so nothing is lost
+    // between frames, analysing every hop that has arrived (beat detection needs them all);
+    // whichever consumer reads next picks the newest window up
+    if (buffers == nullptr || use_capture_task || !streaming_capture || users == 0) return;
+    while (capture_stream(0)) {
+      analyze_frequencies();
+      publish_levels();
+    }
+  }
+
+  // Newest analysed frame if it is newer than `consumed` (each consumer keeps its own).
+  // With blocking capture and no task, a consumer that has seen the newest frame
+  // captures and analyses the next one itself; the others then just read it.
+  bool read(AudioLevels &levels, uint32_t &consumed) {
+    if (buffers == nullptr) return false;
+    if (!use_capture_task && !streaming_capture &&
+        levels_published.load(std::memory_order_acquire) == consumed) {
+      sample_audio();
+      analyze_frequencies();
+      publish_levels();
+    }
+
+    uint32_t seq;
+    do {
+      seq = levels_published.load(std::memory_order_acquire);
+      if (seq == consumed) return false;
+      levels = level_buffers[seq & 1];
+      // The copy must be done before the re-check below, not just before the next load
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while (levels_published.load(std::memory_order_relaxed) != seq);
+    consumed = seq;
+    return true;
+  }
+
+  // Band sensors for every consumer; whoever renders a frame passes its levels here
+  void publish_sensors(const AudioLevels &levels) {
+    uint32_t now = millis();
+    if (now - last_sensor_publish < SENSOR_INTERVAL_MS) return;
+    last_sensor_publish = now;
+    bass_sensor.publish_state(levels.bass * 100.0);
+    mid_sensor.publish_state(levels.mid * 100.0);
+    treble_sensor.publish_state(levels.treble * 100.0);
+    bpm_sensor.publish_state(levels.bpm);
+  }
+
+  // A consumer that needs the microphone; before setup()
+  void enable_capture() {
+    capture_enabled = true;
+  }
+
+  // Capture only runs while at least one capturing consumer is started
+  void acquire() { users++; }
+  void release() { if (users > 0) users--; }
+
+  // The settings below are shared by every consumer, the last one set wins
+
+  // Must be set before setup(), e.g. from the component schema
+  void set_capture_task(bool enable) {
+    use_capture_task = enable;
+  }
+
+  // Number of log-spaced spectrum bands (1 - MAX_SPECTRUM_BANDS), set before setup()
+  void set_num_bands(int bands) {
+    num_bands = constrain(bands, 1, MAX_SPECTRUM_BANDS);
+  }
+
+  // overlap: fraction of each window shared with the previous one (0.0 - 0.75)
+  void set_streaming_capture(bool enable, float overlap) {
+    streaming_capture = enable;
+    hop_size = max(I2S_READ_CHUNK, (int)(SAMPLES * (1.0 - overlap)));
+  }
+
+  void set_sensitivity(float sens) {
+    sensitivity = sens;
+  }
+
+  // Per-band AGC and noise floor; off falls back to sensitivity + hard clamp
+  void set_auto_gain(bool enable) {
+    auto_gain = enable;
+  }
+
+  // Onset threshold in standard deviations above the recent mean flux (default 1.5)
+  void set_beat_sensitivity(float k) {
+    onset_detector.threshold_k = k;
+  }
+
+  int get_num_bands() const { return num_bands; }
+  StageStats get_capture_stats() const { return capture_timer.last(); }
+  StageStats get_fft_stats() const { return fft_timer.last(); }
+
+  esphome::sensor::Sensor *get_bass_sensor() { return &bass_sensor; }
+  esphome::sensor::Sensor *get_mid_sensor() { return &mid_sensor; }
+  esphome::sensor::Sensor *get_treble_sensor() { return &treble_sensor; }
+  esphome::sensor::Sensor *get_bpm_sensor() { return &bpm_sensor; }
+
+ protected:
+  AudioCore() = default;
+
+  const i2s_port_t I2S_PORT = I2S_NUM_0;
+  bool capture_enabled = false;
+  std::atomic<int> users{0};
+  AudioAnalysisBuffers *buffers = nullptr;
+
+  BandRange bass_band, mid_band, treble_band;
+  BandRange spectrum_bands[MAX_SPECTRUM_BANDS];
+  int num_bands = 16;
+  float sensitivity = 1.0;
+
+  // Working levels of the frame being analysed
+  AudioLevels current = {};
+  float spectrum_levels[MAX_SPECTRUM_BANDS] = {0};
+
+  // Automatic gain control (optional, on by default); sensitivity then sets the input gain
+  bool auto_gain = true;
+  BandAGC bass_agc, mid_agc, treble_agc, volume_agc;
+  BandAGC spectrum_agc[MAX_SPECTRUM_BANDS];
+  uint32_t last_analysis = 0;
+
+  // Beat detection, run on every analysed frame
+  OnsetDetector onset_detector;
+
+  // Audio task (optional): capture + FFT on the other core, results via a double buffer.
+  // The writer fills the slot `published` isn't pointing at, then bumps `published`;
+  // a reader retries if a new frame was published while it was copying.
+  bool use_capture_task = false;
+  TaskHandle_t capture_task_handle = nullptr;
+  AudioLevels level_buffers[2];
+  std::atomic<uint32_t> levels_published{0};
+
+  // Streaming capture (optional): the I2S DMA keeps running and every call drains what it
+  // has into a ring of the newest SAMPLES samples. A window is analysed each time hop_size
+  // new samples have arrived, so consecutive windows overlap and no audio is skipped.
+  bool streaming_capture = false;
+  int hop_size = SAMPLES / 2;
+  int ring_head = 0;            // Next write position = oldest sample
+  int samples_since_window = 0;
+
+  StageTimer capture_timer;     // sample_audio() / a streamed window
+  StageTimer fft_timer;         // analyze_frequencies()
+
+  // Band-level publisher, one set of sensors per firmware
+  esphome::sensor::Sensor bass_sensor;
+  esphome::sensor::Sensor mid_sensor;
+  esphome::sensor::Sensor treble_sensor;
+  esphome::sensor::Sensor bpm_sensor;
+  uint32_t last_sensor_publish = 0;
+
+  static void capture_task(void *arg) {
+    auto *self = static_cast<AudioCore *>(arg);
+    while (true) {
+      if (self->users == 0) {
+        vTaskDelay(pdMS_TO_TICKS(50));
+        continue;
+      }
+      if (self->streaming_capture) {
+        if (!self->capture_stream(portMAX_DELAY)) continue;
+      } else {
+        self->sample_audio();
+      }
+      self->analyze_frequencies();
+      self->publish_levels();
+    }
+  }
+
+  // Writer side: fill the free slot, then make it the published one
+  void publish_levels() {
+    uint32_t next = levels_published.load(std::memory_order_relaxed) + 1;
+    level_buffers[next & 1] = current;
+    levels_published.store(next, std::memory_order_release);
+  }
+
+  void sample_audio() {
+    ScopedStageTimer timed(capture_timer);
+    int32_t samples_buffer[I2S_READ_CHUNK];
+
+    for (int offset = 0; offset < SAMPLES; offset += I2S_READ_CHUNK) {
+      size_t bytes_read = 0;
+      i2s_read(I2S_PORT, &samples_buffer, sizeof(samples_buffer), &bytes_read, portMAX_DELAY);
+
+      for (int i = 0; i < I2S_READ_CHUNK; i++) {
+        store_sample(offset + i, samples_buffer[i] / 2147483648.0f);
+      }
+    }
+  }
+
+  // Pull samples from the I2S DMA into the ring until one hop has arrived, waiting up to
+  // `wait` ticks per read; true once a new overlapping window is loaded. Reading stops at
+  // the hop, anything newer stays in the DMA buffers for the next call, so every hop is
+  // analysed instead of only the newest window of a backlog.
+  bool capture_stream(TickType_t wait) {
+    int32_t samples_buffer[I2S_READ_CHUNK];
+    uint32_t start = micros();
+
+    while (samples_since_window < hop_size) {
+      size_t bytes_read = 0;
+      int wanted = min(hop_size - samples_since_window, I2S_READ_CHUNK);
+      i2s_read(I2S_PORT, &samples_buffer, wanted * sizeof(int32_t), &bytes_read, wait);
+      int count = bytes_read / sizeof(int32_t);
+      if (count == 0) return false;
+
+      for (int i = 0; i < count; i++) {
+        buffers->sample_ring[ring_head] = samples_buffer[i] / 2147483648.0f;
+        ring_head = (ring_head + 1) % SAMPLES;
+      }
+      samples_since_window += count;
+    }
+    samples_since_window = 0;
+
+    // Unroll the ring oldest-first into the FFT input
+    for (int i = 0; i < SAMPLES; i++) {
+      store_sample(i, buffers->sample_ring[(ring_head + i) % SAMPLES]);
+    }
+    // Only calls that complete a window are timed; the empty drains in between are not frames
+    capture_timer.record(micros() - start, millis());
+    return true;
+  }
+
+  void store_sample(int i, float sample) {
+    // Hamming window from the table, applied while the sample is stored
+#ifdef MUSIC_FFT_ESP_DSP
+    buffers->fft_data[i * 2] = sample * buffers->fft_window[i];
+    buffers->fft_data[i * 2 + 1] = 0.0f;
+#else
+    buffers->vReal[i] = sample * buffers->fft_window[i];
+    buffers->vImag[i] = 0.0;
+#endif
+  }
+
+  void compute_fft() {
+#ifdef MUSIC_FFT_ESP_DSP
+    float *fft_data = buffers->fft_data;
+    dsps_fft2r_fc32(fft_data, SAMPLES);
+    dsps_bit_rev_fc32(fft_data, SAMPLES);
+    // Bin i only reads entries 2i and 2i+1, so writing magnitude i is safe in place
+    for (int i = 0; i < SAMPLES / 2; i++) {
+      float re = fft_data[i * 2];
+      float im = fft_data[i * 2 + 1];
+      fft_data[i] = sqrtf(re * re + im * im);
+    }
+#else
+    buffers->FFT.Compute(buffers->vReal, buffers->vImag, SAMPLES, FFT_FORWARD);
+    buffers->FFT.ComplexToMagnitude(buffers->vReal, buffers->vImag, SAMPLES);
+#endif
+  }
+
+  // Raw magnitude of one FFT bin
+  float magnitude(int bin) const {
+#ifdef MUSIC_FFT_ESP_DSP
+    return buffers->fft_data[bin];
+#else
+    return buffers->vReal[bin];
+#endif
+  }
+
+  static constexpr int freq_to_bin(double hz) {
+    return (int)(hz * SAMPLES / SAMPLING_FREQUENCY);
+  }
+
+  // Averages over the range and scales by 256/SAMPLES so levels don't depend on FFT size
+  static BandRange make_band(int first_bin, int last_bin) {
+    BandRange band;
+    band.first_bin = first_bin;
+    band.last_bin = last_bin;
+    band.scale = (256.0f / SAMPLES) / (last_bin - first_bin + 1);
+    return band;
+  }
+
+  void build_analysis_tables() {
+    for (int i = 0; i < SAMPLES; i++) {
+      buffers->fft_window[i] = 0.54f - 0.46f * cosf(2.0f * M_PI * i / (SAMPLES - 1));
+    }
+
+    bass_band = make_band(1, freq_to_bin(550));                       // 0-500Hz, skip DC bin 0
+    mid_band = make_band(freq_to_bin(550), freq_to_bin(2000));        // 500-2000Hz
+    treble_band = make_band(freq_to_bin(2000), freq_to_bin(8000));    // 2000-8000Hz
+
+    // Log-spaced spectrum bands; at small FFT sizes the low bands are widened to
+    // at least one bin each so every band maps to distinct bins
+    double ratio = pow(SPECTRUM_MAX_HZ / SPECTRUM_MIN_HZ, 1.0 / num_bands);
+    int prev_last = 0;
+    for (int b = 0; b < num_bands; b++) {
+      double low_hz = SPECTRUM_MIN_HZ * pow(ratio, b);
+      int first = max(freq_to_bin(low_hz), prev_last + 1);
+      int last = max(first, freq_to_bin(low_hz * ratio));
+      last = min(last, SAMPLES / 2 - 1);
+      first = min(first, last);
+      spectrum_bands[b] = make_band(first, last);
+      prev_last = last;
+    }
+  }
+
+  float band_level(const BandRange &band) const {
+    float sum = 0.0;
+    for (int i = band.first_bin; i <= band.last_bin; i++) {
+      sum += magnitude(i);
+    }
+    return sum * band.scale;
+  }
+
+  void analyze_frequencies() {
+    ScopedStageTimer timed(fft_timer);
+    compute_fft();
+
+    AudioLevels &out = current;
+    out.bass = band_level(bass_band);
+    out.mid = band_level(mid_band);
+    out.treble = band_level(treble_band);
+
+    // Overall volume
+    out.volume = (out.bass + out.mid + out.treble) / 3.0;
+
+    // Apply sensitivity
+    out.bass *= sensitivity;
+    out.mid *= sensitivity;
+    out.treble *= sensitivity;
+    out.volume *= sensitivity;
+
+    // Log-spaced spectrum for the fft_bins in the sync packet; unused entries stay 0
+    int loudest = 0;
+    for (int b = 0; b < MAX_SPECTRUM_BANDS; b++) {
+      spectrum_levels[b] = b < num_bands ? band_level(spectrum_bands[b]) * sensitivity : 0.0;
+      if (spectrum_levels[b] > spectrum_levels[loudest]) loudest = b;
+    }
+    out.peak_magnitude = spectrum_levels[loudest];
+    out.peak_hz = (spectrum_bands[loudest].first_bin + spectrum_bands[loudest].last_bin) * 0.5f *
+                  SAMPLING_FREQUENCY / SAMPLES;
+
+    if (auto_gain) {
+      uint32_t now = millis();
+      float dt = last_analysis == 0 ? 0.05 : (now - last_analysis) / 1000.0;
+      last_analysis = now;
+      AgcRates rates = BandAGC::rates(dt);
+      out.bass = bass_agc.process(out.bass, rates);
+      out.mid = mid_agc.process(out.mid, rates);
+      out.treble = treble_agc.process(out.treble, rates);
+      out.volume = volume_agc.process(out.volume, rates);
+      for (int b = 0; b < num_bands; b++) {
+        out.fft_bins[b] = (uint8_t)(spectrum_agc[b].process(spectrum_levels[b], rates) * 255.0);
+      }
+    } else {
+      // Clamp
+      out.bass = constrain(out.bass, 0.0, 1.0);
+      out.mid = constrain(out.mid, 0.0, 1.0);
+      out.treble = constrain(out.treble, 0.0, 1.0);
+      out.volume = constrain(out.volume, 0.0, 1.0);
+      for (int b = 0; b < num_bands; b++) {
+        out.fft_bins[b] = (uint8_t)(constrain(spectrum_levels[b] * 255.0, 0.0, 255.0));
+      }
+    }
+    for (int b = num_bands; b < MAX_SPECTRUM_BANDS; b++) {
+      out.fft_bins[b] = 0;
+    }
+    out.bin_count = num_bands;
+
+    // Onsets from the unclamped bands, so loud passages still show rising energy
+    if (onset_detector.process(spectrum_levels, num_bands, millis())) {
+      ESP_LOGV("audio", "Beat #%u, %.1f BPM", onset_detector.beat_count, onset_detector.bpm());
+    }
+    out.beat_count = onset_detector.beat_count;
+    out.bpm = onset_detector.bpm();
+  }
+};
@@ -1,27 +1,93 @@
 #pragma once
 
+#include <vector>
 #include "esphome.h"
-#include "arduinoFFT.h"
 #include <WiFi.h>
 #include <WiFiUdp.h>
-#include <driver/i2s.h>
+#include "audio_core.h"
 #include "esphome/components/fastcon/fastcon_controller.h"
+#include "esphome/components/fastcon/fastcon_scheduler.h"
 
-#define SAMPLES 256
-#define SAMPLING_FREQUENCY 22050
-#define UDP_PORT 11988  // WLED sound sync port
-#define UDP_PACKET_SIZE 24  // FFT data packet size
+#define UDP_MAX_PACKET_SIZE 64
 
-// UDP packet structure (compatible with WLED)
-struct AudioSyncPacket {
-  uint8_t header[2];        // 'A', 'S' (Audio Sync)
-  uint8_t volume;           // Overall volume 0-255
-  uint8_t bass;             // Bass level 0-255
-  uint8_t mid;              // Mid level 0-255
-  uint8_t treble;           // Treble level 0-255
-  uint8_t fft_bins[18];     // Simplified FFT spectrum (18 bins)
+// Audio sync wire formats. Native is our own versioned format, serialised field by
+// field (little endian) instead of memcpy'ing a struct:
+//   0  'B' 'A'   magic
+//   2  version   SYNC_VERSION
+//   3  flags     SYNC_FLAG_*
+//   4  u16       sequence, +1 per packet
+//   6  u32       master millis() when the frame was analysed
+//   10 u8 x4     volume, bass, mid, treble (0-255)
+//   14 u8        tempo in BPM, 0 = none
+//   15 u8        bin count N (0 - MAX_SPECTRUM_BANDS)
+//   16 u8 x N    spectrum bins
+// WLED is the 44-byte "00002" audio sync packet, so WLED nodes can follow the master.
+// The original 'AS' packet (AudioSyncPacket, audio_core.h) is still decoded from older masters,
+// and is what a master sends by default: fft_analyzer_udp.h slaves only understand 'AS', so a
+// fleet switches to native once every slave runs this component.
+enum SyncProtocol : uint8_t {
+  SYNC_NATIVE = 0,
+  SYNC_WLED = 1,
+  SYNC_LEGACY = 2,
 };
 
+// How the master fans packets out. Broadcast goes out at the AP's lowest basic rate;
+// multicast to a group (one per music zone) or unicast to known slaves avoids that.
+enum SyncTransport : uint8_t {
+  TRANSPORT_BROADCAST = 0,
+  TRANSPORT_MULTICAST = 1,
+  TRANSPORT_UNICAST = 2,
+};
+
+#define SYNC_MAGIC_0 'B'
+#define SYNC_MAGIC_1 'A'
+#define SYNC_VERSION 1
+#define SYNC_HEADER_SIZE 16
+#define SYNC_FLAG_BEAT 0x01     // A beat was detected since the previous packet
+#define WLED_PACKET_SIZE 44
+#define WLED_FFT_BINS 16
+
+// Last color sent to one target, for send-on-change
+struct ColorGate {
+  uint8_t rgb[3];
+  uint32_t time;
+  bool sent;
+};
+
+// What drives one light in the per-light table
+enum MapSource : uint8_t {
+  MAP_SPECTRUM = 0,
+  MAP_BASS = 1,
+  MAP_MID = 2,
+  MAP_TREBLE = 3,
+  MAP_VOLUME = 4,
+};
+
+// One light or group of the per-light table ("Per Light" / "Spectrum" modes). For
+// MAP_SPECTRUM with first_bin < 0 the bins are split evenly across the spectrum lights
+// in table order (a row); a hue < 0 runs red to blue along the table.
+struct LightMapping {
+  uint8_t addr[2];
+  MapSource source;
+  int first_bin;
+  int last_bin;
+  float hue;
+  ColorGate gate;
+};
+
+#define MAX_MAPPED_LIGHTS 16   // FastconScheduler effect lane capacity
+
+// One frame waiting in the playout buffer for its deadline (local millis())
+struct PlayoutFrame {
+  uint32_t due;
+  bool beat;
+  AudioLevels levels;
+};
+
+#define PLAYOUT_FRAMES 8
+#define MAX_DRAIN_PACKETS 16   // Bounds the time one slave loop spends reading UDP
+#define CLOCK_WINDOW_MS 10000  // Minimum-transit window for the clock offset estimate
+
 class MusicReactiveEffectUDP : public esphome::Component {
  private:
   bool is_master;           // True = mic + broadcast, False = receive only
@@ -31,64 +97,130 @@ class MusicReactiveEffectUDP : public esphome::Component {
   WiFiUDP udp;
   IPAddress broadcast_ip;
   String master_ip = "";
+  IPAddress master_addr;              // Slaves only accept packets from here when set
+  bool filter_master = false;
   bool udp_initialized = false;
+  SyncTransport transport = TRANSPORT_BROADCAST;
+  IPAddress multicast_group = IPAddress(239, 0, 11, 98);
+  std::vector<IPAddress> unicast_targets;
+  unsigned long packets_foreign = 0;  // Dropped because they came from another master
   
-  // FFT data (master only)
-  arduinoFFT FFT = arduinoFFT();
-  double vReal[SAMPLES];
-  double vImag[SAMPLES];
-  const i2s_port_t I2S_PORT = I2S_NUM_0;
+  // Capture, FFT, band levels and the band sensors are shared by every music effect in
+  // the firmware; the master reads analysed frames from the core
+  AudioCore *audio = nullptr;
+  uint32_t levels_consumed = 0;
   
   // Frequency levels (both master and slave)
   float bass_level = 0.0;
   float mid_level = 0.0;
   float treble_level = 0.0;
   float volume = 0.0;
+  uint8_t fft_bins[18] = {0};
+  uint8_t bin_count = 0;
+  float peak_magnitude = 0.0;
+  float peak_hz = 0.0;
+  
+  // The master's beats come from the core; slaves run this on legacy packets, which carry none
+  OnsetDetector onset_detector;
+  float spectrum_levels[MAX_SPECTRUM_BANDS] = {0};
+  uint32_t beat_count = 0;
+  uint32_t beats_handled = 0;
+  float bpm = 0.0;
+  uint32_t beats_scheduled = 0;
+  uint32_t beats_played = 0;
+  bool beat_now = false;        // A beat was played since the previous color command
+  bool beat_sync = false;       // Only send color commands on beats
   
   // Settings
-  float sensitivity = 1.0;
   float update_rate = 10.0;
   uint8_t target_addr[2] = {0x2a, 0xa8};
   String color_mode = "RGB Frequency";
+  SyncProtocol sync_protocol = SYNC_LEGACY;
+  
+  // Send-on-change: frames closer than color_threshold to the last sent color are
+  // dropped before they reach the mesh; keepalive_ms still refreshes a static color
+  float color_threshold = 8.0;    // Redmean distance, 0 - ~765
+  uint32_t keepalive_ms = 1000;
+  ColorGate color_gate = {};
+  unsigned long frames_suppressed = 0;
+  
+  // Per-light table: every light's color comes from the same played frame and the
+  // changed ones go to the scheduler as one batch. Spectrum sources read the bins with
+  // peak hold, so the row stays continuous across frames and a dropped packet doesn't blank it.
+  std::vector<LightMapping> light_map;
+  uint8_t batch_payloads[MAX_MAPPED_LIGHTS][12];
+  float spectrum_display[MAX_SPECTRUM_BANDS] = {0};
+  float spectrum_decay = 0.85;    // Per rendered frame
   
   // Statistics
   unsigned long packet_count = 0;
   unsigned long last_packet_time = 0;
   unsigned long last_update = 0;
   
-  // Sensors
-  esphome::sensor::Sensor *bass_sensor = new esphome::sensor::Sensor();
-  esphome::sensor::Sensor *mid_sensor = new esphome::sensor::Sensor();
-  esphome::sensor::Sensor *treble_sensor = new esphome::sensor::Sensor();
+  // Sequencing: the master numbers its packets, slaves drop anything not newer than
+  // the last one applied and track transit jitter from the master timestamps
+  uint16_t tx_sequence = 0;
+  uint32_t beats_broadcast = 0;
+  uint16_t last_sequence = 0;
+  bool have_sequence = false;
+  int32_t last_transit = 0;
+  bool have_transit = false;
+  float jitter_ms = 0.0;
+  unsigned long packets_reordered = 0;
+  unsigned long packets_lost = 0;
+  bool drain_packets = true;          // Read every queued datagram per loop, keep the newest
+  unsigned long packets_discarded = 0;
+  
+  // Playout: frames are rendered at a deadline instead of on arrival. Slaves map the
+  // master timestamp to local time with clock_offset, the smallest transit time seen
+  // (= clock difference + the fastest network path), so every node renders a frame at
+  // master time + playout_delay_ms and WiFi jitter is absorbed by the buffer. The
+  // master holds its own frames back by the same delay.
+  uint32_t playout_delay_ms = 60;
+  PlayoutFrame playout[PLAYOUT_FRAMES];
+  int playout_head = 0;
+  int playout_count = 0;
+  AudioLevels shown = {};       // Levels currently on the lights
+  bool clock_synced = false;
+  int32_t clock_offset = 0;
+  int32_t window_min_transit = 0;
+  int32_t prev_window_min_transit = 0;
+  uint32_t clock_window_start = 0;
+  unsigned long frames_late = 0;      // Arrived after their deadline
+  unsigned long frames_overrun = 0;   // Dropped because the buffer was full
+  
+  // Profiling: where the time of a frame goes (I2S, FFT, light mapping, WiFi), plus
+  // frames whose processing took longer than the frame interval and per-window UDP
+  // rates and loss. A summary is logged at debug level once per window.
+  StageTimer mapping_timer;     // send_color_command()
+  StageTimer send_timer;        // broadcast_audio_data()
+  StageTimer receive_timer;     // One datagram read and decoded
+  StageTimer frame_timer;       // A whole master frame / slave loop pass with packets
+  unsigned long frame_overruns = 0;
+  uint32_t profile_window_start = 0;
+  unsigned long window_packets = 0;   // Sent (master) or accepted (slave) this window
+  unsigned long window_lost_base = 0;
+  float packet_rate = 0.0;            // Per second, last window
+  float loss_percent = 0.0;           // Last window
   
   esphome::fastcon::FastconController *controller = nullptr;
+  esphome::fastcon::FastconScheduler *scheduler = nullptr;
 
  public:
-  MusicReactiveEffectUDP(bool master_mode) : is_master(master_mode) {}
+  MusicReactiveEffectUDP(bool master_mode) : is_master(master_mode) {
+    audio = AudioCore::get();
+    if (is_master) audio->enable_capture();
+  }
   
   void set_controller(esphome::fastcon::FastconController *ctrl) {
     controller = ctrl;
+    // Frames go through the effect lane so interactive light commands stay responsive
+    scheduler = esphome::fastcon::FastconScheduler::for_controller(ctrl);
   }
 
   void setup() override {
     if (is_master) {
-      // Initialize I2S microphone
-      i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = SAMPLING_FREQUENCY,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = I2S_COMM_FORMAT_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 4,
-        .dma_buf_len = 1024,
-        .use_apll = false,
-        .tx_desc_auto_clear = false,
-        .fixed_mclk = 0
-      };
-      
-      i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
-      ESP_LOGI("music-udp", "Master mode: Microphone initialized");
+      ESP_LOGI("music-udp", "Master mode: Analysing audio from the shared core");
     } else {
       ESP_LOGI("music-udp", "Slave mode: Waiting for UDP packets");
     }
@@ -101,8 +233,12 @@ class MusicReactiveEffectUDP : public esphome::Component {
     }
 
     if (!udp_initialized) {
-      // Start UDP
-      udp.begin(UDP_PORT);
+      // Start UDP; with multicast only slaves join the group, the master just sends to it
+      if (transport == TRANSPORT_MULTICAST && !is_master) {
+        udp.beginMulticast(multicast_group, UDP_PORT);
+      } else {
+        udp.begin(UDP_PORT);
+      }
       
       // Calculate broadcast address
       IPAddress local_ip = WiFi.localIP();
@@ -114,8 +250,16 @@ class MusicReactiveEffectUDP : public esphome::Component {
         local_ip[3] | (~subnet[3])
       );
       
-      ESP_LOGI("music-udp", "UDP initialized on port %d, broadcast: %s", 
-               UDP_PORT, broadcast_ip.toString().c_str());
+      if (transport == TRANSPORT_MULTICAST) {
+        ESP_LOGI("music-udp", "UDP initialized on port %d, multicast group: %s",
+                 UDP_PORT, multicast_group.toString().c_str());
+      } else if (transport == TRANSPORT_UNICAST) {
+        ESP_LOGI("music-udp", "UDP initialized on port %d, unicast to %d slaves",
+                 UDP_PORT, unicast_targets.size());
+      } else {
+        ESP_LOGI("music-udp", "UDP initialized on port %d, broadcast: %s", 
+                 UDP_PORT, broadcast_ip.toString().c_str());
+      }
       udp_initialized = true;
     }
 
@@ -134,39 +278,98 @@ class MusicReactiveEffectUDP : public esphome::Component {
     unsigned long now = millis();
     unsigned long interval = 1000.0 / update_rate;
     
+    play_due_frames();
+    
     if (now - last_update < interval) return;
-    last_update = now;
+    uint32_t frame_start = micros();
     
-    // Sample and analyze audio
-    sample_audio();
-    analyze_frequencies();
+    // Newest frame from the core: the audio task's or streamed result, or a blocking
+    // capture when this effect is the first to read since the last one
+    AudioLevels levels;
+    if (!audio->read(levels, levels_consumed)) return;
+    apply_levels(levels);
+    last_update = now;
     
     // Broadcast FFT data over UDP
     if (udp_enabled) {
       broadcast_audio_data();
     }
     
-    // Control local lights
-    send_color_command();
+    // Local lights show the frame at the same deadline as the slaves
+    bool beat = beat_count != beats_scheduled;
+    beats_scheduled = beat_count;
+    // Same reference as the packet's timestamp, taken after the (blocking) analysis
+    schedule_frame(current_levels(), beat, millis() + playout_delay_ms);
+    play_due_frames();
+    end_frame(frame_start, interval);
+  }
+  
+  // Frame bookkeeping for the profiler; rolls the UDP window too
+  void end_frame(uint32_t frame_start, uint32_t budget_ms) {
+    uint32_t us = micros() - frame_start;
+    uint32_t now = millis();
+    frame_timer.record(us, now);
+    if (us > budget_ms * 1000) frame_overruns++;
     
-    // Update sensors
-    update_sensors();
+    if (now - profile_window_start < PROFILE_WINDOW_MS) return;
+    float seconds = (now - profile_window_start) / 1000.0;
+    unsigned long lost = packets_lost - window_lost_base;
+    packet_rate = profile_window_start == 0 ? 0.0 : window_packets / seconds;
+    loss_percent = window_packets + lost > 0 ? 100.0 * lost / (window_packets + lost) : 0.0;
+    window_packets = 0;
+    window_lost_base = packets_lost;
+    profile_window_start = now;
+    log_profile();
+  }
+  
+  void log_profile() {
+    // One snapshot per stage, so min/avg/max always come from the same window
+    StageStats capture = audio->get_capture_stats(), fft = audio->get_fft_stats();
+    StageStats mapping = mapping_timer.last(), send = send_timer.last();
+    StageStats receive = receive_timer.last(), frame = frame_timer.last();
+    ESP_LOGD("music-udp", "Profile (us min/avg/max): capture %u/%u/%u fft %u/%u/%u map %u/%u/%u "
+             "send %u/%u/%u recv %u/%u/%u frame %u/%u/%u",
+             capture.min_us, capture.avg_us, capture.max_us, fft.min_us, fft.avg_us, fft.max_us,
+             mapping.min_us, mapping.avg_us, mapping.max_us, send.min_us, send.avg_us, send.max_us,
+             receive.min_us, receive.avg_us, receive.max_us, frame.min_us, frame.avg_us, frame.max_us);
+    ESP_LOGD("music-udp", "Profile: %lu frame overruns, %.1f packets/s, %.1f%% lost, jitter %.1f ms",
+             frame_overruns, packet_rate, loss_percent, jitter_ms);
   }
   
   void slave_loop() {
-    // Check for UDP packets
-    int packet_size = udp.parsePacket();
-    if (packet_size >= UDP_PACKET_SIZE) {
-      receive_audio_data();
-      
-      // Control lights based on received data
-      unsigned long now = millis();
-      if (now - last_update >= 50) {  // Max 20fps
-        last_update = now;
-        send_color_command();
-        update_sensors();
+    // Empty the socket so latency can't build up when the master sends faster than we
+    // loop; only the newest frame is scheduled, beats from the skipped ones carry over
+    PlayoutFrame frame, next;
+    bool have_frame = false;
+    uint32_t frame_start = micros();
+    int reads = 0;
+    for (; reads < MAX_DRAIN_PACKETS && udp.parsePacket() > 0; reads++) {
+      // Several zones can share a LAN; only follow our own master
+      if (filter_master && udp.remoteIP() != master_addr) {
+        packets_foreign++;
+        continue;
+      }
+      uint32_t receive_start = micros();
+      bool accepted = receive_audio_data(next);
+      receive_timer.record(micros() - receive_start, millis());
+      if (!accepted) continue;
+      window_packets++;
+      if (have_frame) {
+        next.beat |= frame.beat;
+        packets_discarded++;
       }
+      frame = next;
+      have_frame = true;
+      if (!drain_packets) break;
     }
+    if (have_frame) {
+      schedule_frame(frame.levels, frame.beat, frame.due);
+    }
+    
+    // Control lights when the next frame's deadline has come
+    play_due_frames();
+    // Idle passes would drown the averages, only those that did work count as frames
+    if (reads > 0) end_frame(frame_start, 1000.0 / update_rate);
     
     // Timeout detection (no data received)
     if (millis() - last_packet_time > 5000 && packet_count > 0) {
@@ -174,170 +377,466 @@ class MusicReactiveEffectUDP : public esphome::Component {
     }
   }
   
-  void sample_audio() {
-    size_t bytes_read = 0;
-    int32_t samples_buffer[SAMPLES];
-    
-    i2s_read(I2S_PORT, &samples_buffer, sizeof(samples_buffer), &bytes_read, portMAX_DELAY);
-    
-    for (int i = 0; i < SAMPLES; i++) {
-      vReal[i] = (double)samples_buffer[i] / 2147483648.0;
-      vImag[i] = 0.0;
+  AudioLevels current_levels() {
+    AudioLevels levels;
+    levels.bass = bass_level;
+    levels.mid = mid_level;
+    levels.treble = treble_level;
+    levels.volume = volume;
+    memcpy(levels.fft_bins, fft_bins, sizeof(fft_bins));
+    levels.bin_count = bin_count;
+    levels.beat_count = beat_count;
+    levels.bpm = bpm;
+    return levels;
+  }
+  
+  // Frames are queued in arrival order, which sequencing keeps equal to deadline order
+  void schedule_frame(const AudioLevels &levels, bool beat, uint32_t due) {
+    uint32_t now = millis();
+    if ((int32_t)(due - now) < 0) frames_late++;
+    if (playout_count == PLAYOUT_FRAMES) {
+      playout_head = (playout_head + 1) % PLAYOUT_FRAMES;
+      playout_count--;
+      frames_overrun++;
     }
+    PlayoutFrame &frame = playout[(playout_head + playout_count) % PLAYOUT_FRAMES];
+    frame.due = due;
+    frame.beat = beat;
+    frame.levels = levels;
+    playout_count++;
   }
   
-  void analyze_frequencies() {
-    FFT.Windowing(vReal, SAMPLES, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
-    FFT.Compute(vReal, vImag, SAMPLES, FFT_FORWARD);
-    FFT.ComplexToMagnitude(vReal, vImag, SAMPLES);
-    
-    // Bass: 0-500Hz (bins 0-6)
-    bass_level = 0.0;
-    for (int i = 1; i <= 6; i++) {
-      bass_level += vReal[i];
+  // Render the newest frame that is due; beats of skipped frames still count
+  void play_due_frames() {
+    uint32_t now = millis();
+    bool played = false;
+    while (playout_count > 0 && (int32_t)(now - playout[playout_head].due) >= 0) {
+      const PlayoutFrame &frame = playout[playout_head];
+      shown = frame.levels;
+      if (frame.beat) beats_played++;
+      playout_head = (playout_head + 1) % PLAYOUT_FRAMES;
+      playout_count--;
+      played = true;
     }
-    bass_level /= 6.0;
+    if (!played) return;
     
-    // Mid: 500-2000Hz (bins 6-23)
-    mid_level = 0.0;
-    for (int i = 6; i <= 23; i++) {
-      mid_level += vReal[i];
+    for (int b = 0; b < MAX_SPECTRUM_BANDS; b++) {
+      float level = b < shown.bin_count ? shown.fft_bins[b] / 255.0f : 0.0f;
+      spectrum_display[b] = max(level, spectrum_display[b] * spectrum_decay);
     }
-    mid_level /= 18.0;
     
-    // Treble: 2000-8000Hz (bins 23-93)
-    treble_level = 0.0;
-    for (int i = 23; i <= 93; i++) {
-      treble_level += vReal[i];
+    if (take_beat() || !beat_sync) {
+      send_color_command();
     }
-    treble_level /= 71.0;
+    update_sensors();
+  }
+  
+  // Windowed minimum of (local receive time - master timestamp). Taking the smaller of
+  // the current and previous window follows crystal drift without jumping on one slow packet.
+  void update_clock(uint32_t timestamp, uint32_t now) {
+    int32_t transit = (int32_t)(now - timestamp);
+    if (!clock_synced) {
+      window_min_transit = prev_window_min_transit = transit;
+      clock_window_start = now;
+      clock_synced = true;
+    } else if (now - clock_window_start >= CLOCK_WINDOW_MS) {
+      prev_window_min_transit = window_min_transit;
+      window_min_transit = transit;
+      clock_window_start = now;
+    } else if (transit < window_min_transit) {
+      window_min_transit = transit;
+    }
+    clock_offset = min(window_min_transit, prev_window_min_transit);
+  }
+  
+  // A frame read from the core becomes the master's current levels
+  void apply_levels(const AudioLevels &levels) {
+    bass_level = levels.bass;
+    mid_level = levels.mid;
+    treble_level = levels.treble;
+    volume = levels.volume;
+    memcpy(fft_bins, levels.fft_bins, sizeof(fft_bins));
+    bin_count = levels.bin_count;
+    beat_count = levels.beat_count;
+    bpm = levels.bpm;
+    peak_magnitude = levels.peak_magnitude;
+    peak_hz = levels.peak_hz;
+  }
+  
+  // Beats are counted where they are played, so one landing in a frame that was never
+  // rendered still registers; true once per new beat count
+  bool take_beat() {
+    beat_now = beats_played != beats_handled;
+    beats_handled = beats_played;
+    return beat_now;
+  }
+  
+  void detect_beat(int count) {
+    if (onset_detector.process(spectrum_levels, count, millis())) {
+      ESP_LOGV("music-udp", "Beat #%u, %.1f BPM", onset_detector.beat_count, onset_detector.bpm());
+    }
+    beat_count = onset_detector.beat_count;
+    bpm = onset_detector.bpm();
+  }
+  
+  static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+  }
+  
+  static void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+  }
+  
+  static uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+  }
+  
+  static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+  
+  // Serialise the current levels in the configured format; returns the datagram length
+  size_t encode_packet(uint8_t *buf) {
+    bool beat = beat_count != beats_broadcast;
+    beats_broadcast = beat_count;
+    uint16_t sequence = tx_sequence++;
     
-    // Overall volume
-    volume = (bass_level + mid_level + treble_level) / 3.0;
+    if (sync_protocol == SYNC_WLED) {
+      // WLED audioSyncPacket v2; the layout includes the struct's alignment padding
+      memset(buf, 0, WLED_PACKET_SIZE);
+      memcpy(buf, "00002", 6);
+      float sample = volume * 255.0f;
+      memcpy(buf + 8, &sample, 4);            // sampleRaw
+      memcpy(buf + 12, &sample, 4);           // sampleSmth
+      buf[16] = beat ? 1 : 0;                 // samplePeak
+      buf[17] = sequence & 0xFF;              // frameCounter
+      for (int i = 0; i < WLED_FFT_BINS; i++) {
+        buf[18 + i] = fft_bins[i * max((int)bin_count, 1) / WLED_FFT_BINS];
+      }
+      memcpy(buf + 36, &peak_magnitude, 4);   // FFT_Magnitude
+      memcpy(buf + 40, &peak_hz, 4);          // FFT_MajorPeak
+      return WLED_PACKET_SIZE;
+    }
     
-    // Apply sensitivity
-    bass_level *= sensitivity;
-    mid_level *= sensitivity;
-    treble_level *= sensitivity;
-    volume *= sensitivity;
+    if (sync_protocol == SYNC_LEGACY) {
+      AudioSyncPacket packet;
+      packet.header[0] = 'A';
+      packet.header[1] = 'S';
+      packet.volume = (uint8_t)(volume * 255.0);
+      packet.bass = (uint8_t)(bass_level * 255.0);
+      packet.mid = (uint8_t)(mid_level * 255.0);
+      packet.treble = (uint8_t)(treble_level * 255.0);
+      memcpy(packet.fft_bins, fft_bins, sizeof(packet.fft_bins));
+      memcpy(buf, &packet, sizeof(packet));
+      return sizeof(packet);
+    }
     
-    // Clamp
-    bass_level = constrain(bass_level, 0.0, 1.0);
-    mid_level = constrain(mid_level, 0.0, 1.0);
-    treble_level = constrain(treble_level, 0.0, 1.0);
-    volume = constrain(volume, 0.0, 1.0);
+    buf[0] = SYNC_MAGIC_0;
+    buf[1] = SYNC_MAGIC_1;
+    buf[2] = SYNC_VERSION;
+    buf[3] = beat ? SYNC_FLAG_BEAT : 0;
+    put_u16(buf + 4, sequence);
+    put_u32(buf + 6, millis());
+    buf[10] = (uint8_t)(volume * 255.0);
+    buf[11] = (uint8_t)(bass_level * 255.0);
+    buf[12] = (uint8_t)(mid_level * 255.0);
+    buf[13] = (uint8_t)(treble_level * 255.0);
+    buf[14] = (uint8_t)constrain(bpm + 0.5, 0.0, 255.0);
+    buf[15] = bin_count;
+    memcpy(buf + SYNC_HEADER_SIZE, fft_bins, bin_count);
+    return SYNC_HEADER_SIZE + bin_count;
   }
   
   void broadcast_audio_data() {
-    AudioSyncPacket packet;
-    packet.header[0] = 'A';
-    packet.header[1] = 'S';
-    packet.volume = (uint8_t)(volume * 255.0);
-    packet.bass = (uint8_t)(bass_level * 255.0);
-    packet.mid = (uint8_t)(mid_level * 255.0);
-    packet.treble = (uint8_t)(treble_level * 255.0);
+    ScopedStageTimer timed(send_timer);
+    window_packets++;
+    uint8_t buf[UDP_MAX_PACKET_SIZE];
+    size_t len = encode_packet(buf);
     
-    // Simplified FFT bins for spectrum display
-    for (int i = 0; i < 18; i++) {
-      int fft_idx = (i * SAMPLES / 2) / 18;
-      packet.fft_bins[i] = (uint8_t)(constrain(vReal[fft_idx] * sensitivity * 255.0, 0.0, 255.0));
+    if (transport == TRANSPORT_UNICAST) {
+      for (const auto &target : unicast_targets) {
+        udp.beginPacket(target, UDP_PORT);
+        udp.write(buf, len);
+        udp.endPacket();
+      }
+      return;
     }
     
-    // Broadcast to all devices on network
-    udp.beginPacket(broadcast_ip, UDP_PORT);
-    udp.write((uint8_t*)&packet, sizeof(AudioSyncPacket));
+    udp.beginPacket(transport == TRANSPORT_MULTICAST ? multicast_group : broadcast_ip, UDP_PORT);
+    udp.write(buf, len);
     udp.endPacket();
   }
   
-  void receive_audio_data() {
-    AudioSyncPacket packet;
-    udp.read((uint8_t*)&packet, sizeof(AudioSyncPacket));
+  // Drop duplicates and packets older than the last one applied. `bits` is the width
+  // of the sender's counter; a long silence resets it (master restarted)
+  bool accept_sequence(uint16_t sequence, int bits, uint32_t now) {
+    if (have_sequence && now - last_packet_time < 2000) {
+      int32_t delta = bits == 16 ? (int16_t)(sequence - last_sequence)
+                                 : (int8_t)(uint8_t)(sequence - last_sequence);
+      if (delta <= 0) {
+        packets_reordered++;
+        return false;
+      }
+      packets_lost += delta - 1;
+    } else {
+      // First packet, or the master was gone long enough to have restarted
+      clock_synced = false;
+    }
+    last_sequence = sequence;
+    have_sequence = true;
+    return true;
+  }
+  
+  // RFC 3550 style interarrival jitter from the master timestamps
+  void track_jitter(uint32_t timestamp, uint32_t now) {
+    int32_t transit = (int32_t)(now - timestamp);
+    if (have_transit) {
+      int32_t d = transit - last_transit;
+      jitter_ms += ((d < 0 ? -d : d) - jitter_ms) / 16.0;
+    }
+    last_transit = transit;
+    have_transit = true;
+  }
+  
+  static void set_spectrum(AudioLevels &levels, const uint8_t *bins, int count) {
+    for (int b = 0; b < MAX_SPECTRUM_BANDS; b++) {
+      levels.fft_bins[b] = b < count ? bins[b] : 0;
+    }
+    levels.bin_count = count;
+  }
+  
+  // Decode one datagram in any of the supported formats into `frame`; false if it was
+  // invalid, stale or out of order
+  bool receive_audio_data(PlayoutFrame &frame) {
+    uint8_t buf[UDP_MAX_PACKET_SIZE];
+    int len = udp.read(buf, sizeof(buf));
+    uint32_t now = millis();
+    AudioLevels levels = current_levels();
+    bool beat = false;
+    uint32_t due = now + playout_delay_ms;
     
-    // Verify header
-    if (packet.header[0] != 'A' || packet.header[1] != 'S') {
+    if (len >= SYNC_HEADER_SIZE && buf[0] == SYNC_MAGIC_0 && buf[1] == SYNC_MAGIC_1) {
+      if (buf[2] != SYNC_VERSION) {
+        ESP_LOGW("music-udp", "Unsupported sync protocol version %d", buf[2]);
+        return false;
+      }
+      int count = min((int)buf[15], MAX_SPECTRUM_BANDS);
+      if (len < SYNC_HEADER_SIZE + count) {
+        ESP_LOGW("music-udp", "Truncated sync packet (%d bytes)", len);
+        return false;
+      }
+      if (!accept_sequence(get_u16(buf + 4), 16, now)) return false;
+      uint32_t timestamp = get_u32(buf + 6);
+      track_jitter(timestamp, now);
+      update_clock(timestamp, now);
+      due = timestamp + clock_offset + playout_delay_ms;
+      
+      levels.volume = buf[10] / 255.0;
+      levels.bass = buf[11] / 255.0;
+      levels.mid = buf[12] / 255.0;
+      levels.treble = buf[13] / 255.0;
+      set_spectrum(levels, buf + SYNC_HEADER_SIZE, count);
+      // The master's beats and tempo are used directly, so every node pulses together
+      beat = buf[3] & SYNC_FLAG_BEAT;
+      levels.bpm = buf[14];
+    } else if (len >= WLED_PACKET_SIZE && memcmp(buf, "00002", 6) == 0) {
+      if (!accept_sequence(buf[17], 8, now)) return false;
+      
+      float sample;
+      memcpy(&sample, buf + 12, 4);
+      levels.volume = constrain(sample / 255.0, 0.0, 1.0);
+      // WLED's 16 GEQ channels: 0-3 bass, 4-9 mid, 10-15 treble
+      const uint8_t *fft = buf + 18;
+      levels.bass = (fft[0] + fft[1] + fft[2] + fft[3]) / (4 * 255.0);
+      levels.mid = (fft[4] + fft[5] + fft[6] + fft[7] + fft[8] + fft[9]) / (6 * 255.0);
+      levels.treble = (fft[10] + fft[11] + fft[12] + fft[13] + fft[14] + fft[15]) / (6 * 255.0);
+      set_spectrum(levels, fft, WLED_FFT_BINS);
+      beat = buf[16] != 0;
+    } else if (len >= (int)sizeof(AudioSyncPacket) && buf[0] == 'A' && buf[1] == 'S') {
+      AudioSyncPacket packet;
+      memcpy(&packet, buf, sizeof(packet));
+      levels.volume = packet.volume / 255.0;
+      levels.bass = packet.bass / 255.0;
+      levels.mid = packet.mid / 255.0;
+      levels.treble = packet.treble / 255.0;
+      set_spectrum(levels, packet.fft_bins, MAX_SPECTRUM_BANDS);
+      
+      // No beat information in this format; run the detector on the received spectrum
+      for (int b = 0; b < MAX_SPECTRUM_BANDS; b++) {
+        spectrum_levels[b] = packet.fft_bins[b] / 255.0;
+      }
+      uint32_t before = beat_count;
+      detect_beat(MAX_SPECTRUM_BANDS);
+      beat = beat_count != before;
+      levels.bpm = bpm;
+    } else {
       ESP_LOGW("music-udp", "Invalid packet header");
-      return;
+      return false;
     }
     
-    // Extract frequency levels
-    volume = packet.volume / 255.0;
-    bass_level = packet.bass / 255.0;
-    mid_level = packet.mid / 255.0;
-    treble_level = packet.treble / 255.0;
+    // The received levels are the slave's current levels (status, sensors between frames)
+    volume = levels.volume;
+    bass_level = levels.bass;
+    mid_level = levels.mid;
+    treble_level = levels.treble;
+    memcpy(fft_bins, levels.fft_bins, sizeof(fft_bins));
+    bin_count = levels.bin_count;
+    bpm = levels.bpm;
+    frame.levels = levels;
+    frame.beat = beat;
+    frame.due = due;
     
     // Update statistics
     packet_count++;
-    last_packet_time = millis();
+    last_packet_time = now;
     
-    ESP_LOGV("music-udp", "Received: Vol=%d Bass=%d Mid=%d Treble=%d", 
-             packet.volume, packet.bass, packet.mid, packet.treble);
+    ESP_LOGV("music-udp", "Received: Vol=%.2f Bass=%.2f Mid=%.2f Treble=%.2f",
+             volume, bass_level, mid_level, treble_level);
+    return true;
   }
   
   void send_color_command() {
+    ScopedStageTimer timed(mapping_timer);
     uint8_t r = 0, g = 0, b = 0;
     
+    if (color_mode == "Per Light" || color_mode == "Spectrum") {
+      send_light_map();
+      return;
+    }
+    
     if (color_mode == "RGB Frequency") {
-      r = (uint8_t)(bass_level * 255.0);
-      g = (uint8_t)(mid_level * 255.0);
-      b = (uint8_t)(treble_level * 255.0);
+      r = (uint8_t)(shown.bass * 255.0);
+      g = (uint8_t)(shown.mid * 255.0);
+      b = (uint8_t)(shown.treble * 255.0);
     } else if (color_mode == "Amplitude") {
-      r = g = b = (uint8_t)(volume * 255.0);
+      r = g = b = (uint8_t)(shown.volume * 255.0);
     } else if (color_mode == "Rainbow Cycle") {
-      float max_level = max(bass_level, max(mid_level, treble_level));
+      float max_level = max(shown.bass, max(shown.mid, shown.treble));
       float hue = 0.0;
-      if (max_level == bass_level) hue = 0.0;
-      else if (max_level == mid_level) hue = 0.33;
+      if (max_level == shown.bass) hue = 0.0;
+      else if (max_level == shown.mid) hue = 0.33;
       else hue = 0.66;
       hsv_to_rgb(hue, 1.0, max_level, r, g, b);
     } else if (color_mode == "Bass Pulse") {
-      if (bass_level > 0.6) {
+      // Flash on detected beats; a fixed level threshold misfires whenever the volume changes
+      if (beat_now) {
         r = 255; g = 0; b = 0;
       } else {
-        r = (uint8_t)(bass_level * 100.0);
-        g = (uint8_t)(mid_level * 50.0);
-        b = (uint8_t)(treble_level * 150.0);
+        r = (uint8_t)(shown.bass * 100.0);
+        g = (uint8_t)(shown.mid * 50.0);
+        b = (uint8_t)(shown.treble * 150.0);
       }
     }
     
-    // Build BRMesh command
-    uint8_t payload[12] = {
-      0x93, target_addr[0], target_addr[1], 0x04, 0xff,
-      r, g, b, 0x00, 0x00, 0x00, 0x00
-    };
+    // With beat_sync every frame reaching here is a beat, which must not be swallowed
+    if (!should_send_color(color_gate, r, g, b, beat_sync && beat_now)) return;
+    send_rgb(target_addr, r, g, b);
+  }
+  
+  float mapped_level(const LightMapping &light, int spectrum_index, int spectrum_count) const {
+    switch (light.source) {
+      case MAP_BASS: return shown.bass;
+      case MAP_MID: return shown.mid;
+      case MAP_TREBLE: return shown.treble;
+      case MAP_VOLUME: return shown.volume;
+      default: break;
+    }
     
-    send_mesh_command(payload, 12);
+    int first = light.first_bin;
+    int last = light.last_bin;
+    if (first < 0) {
+      int bins = max((int)shown.bin_count, 1);
+      first = spectrum_index * bins / spectrum_count;
+      last = max(first, (spectrum_index + 1) * bins / spectrum_count - 1);
+    }
+    first = min(first, MAX_SPECTRUM_BANDS - 1);
+    last = constrain(last, first, MAX_SPECTRUM_BANDS - 1);
+    
+    // Loudest bin of the range
+    float level = 0.0;
+    for (int bin = first; bin <= last; bin++) {
+      level = max(level, spectrum_display[bin]);
+    }
+    return level;
   }
   
-  void hsv_to_rgb(float h, float s, float v, uint8_t &r, uint8_t &g, uint8_t &b) {
-    float c = v * s;
-    float x = c * (1.0 - fabs(fmod(h * 6.0, 2.0) - 1.0));
-    float m = v - c;
+  // One pass over the table for the played frame; lights whose color didn't visibly
+  // change are left out, the rest are submitted together in table order
+  void send_light_map() {
+    int lights = light_map.size();
+    int spectrum_count = 0;
+    for (const auto &light : light_map) {
+      if (light.source == MAP_SPECTRUM && light.first_bin < 0) spectrum_count++;
+    }
     
-    float r_prime, g_prime, b_prime;
-    if (h < 0.166) {
-      r_prime = c; g_prime = x; b_prime = 0;
-    } else if (h < 0.333) {
-      r_prime = x; g_prime = c; b_prime = 0;
-    } else if (h < 0.5) {
-      r_prime = 0; g_prime = c; b_prime = x;
-    } else if (h < 0.666) {
-      r_prime = 0; g_prime = x; b_prime = c;
-    } else if (h < 0.833) {
-      r_prime = x; g_prime = 0; b_prime = c;
-    } else {
-      r_prime = c; g_prime = 0; b_prime = x;
+    esphome::fastcon::EffectCommand batch[MAX_MAPPED_LIGHTS];
+    size_t batch_size = 0;
+    int spectrum_index = 0;
+    for (int i = 0; i < lights; i++) {
+      LightMapping &light = light_map[i];
+      float level = mapped_level(light, spectrum_index, max(spectrum_count, 1));
+      if (light.source == MAP_SPECTRUM && light.first_bin < 0) spectrum_index++;
+      
+      uint8_t r, g, b;
+      float hue = light.hue >= 0 ? light.hue : (lights > 1 ? 0.75f * i / (lights - 1) : 0.0f);
+      hsv_to_rgb(hue, 1.0, level, r, g, b);
+      if (!should_send_color(light.gate, r, g, b, beat_sync && beat_now)) continue;
+      
+      uint8_t *payload = batch_payloads[batch_size];
+      build_rgb_payload(payload, light.addr, r, g, b);
+      batch[batch_size].target = (light.addr[0] << 8) | light.addr[1];
+      batch[batch_size].data = payload;
+      batch[batch_size].len = 12;
+      batch_size++;
     }
     
-    r = (uint8_t)((r_prime + m) * 255.0);
-    g = (uint8_t)((g_prime + m) * 255.0);
-    b = (uint8_t)((b_prime + m) * 255.0);
+    if (batch_size == 0) return;
+    if (scheduler != nullptr) {
+      // Send as broadcast (0xFFFF) since each payload contains its target address
+      scheduler->submit_effect_batch(0xFFFF, batch, batch_size);
+      ESP_LOGV("music-udp", "Sent %d light colors as one batch", batch_size);
+    } else {
+      ESP_LOGW("music-udp", "Controller not set, cannot send mesh command");
+    }
+  }
+  
+  static void build_rgb_payload(uint8_t *payload, const uint8_t *addr, uint8_t r, uint8_t g, uint8_t b) {
+    const uint8_t command[12] = {
+      0x93, addr[0], addr[1], 0x04, 0xff,
+      r, g, b, 0x00, 0x00, 0x00, 0x00
+    };
+    memcpy(payload, command, sizeof(command));
+  }
+  
+  void send_rgb(const uint8_t *addr, uint8_t r, uint8_t g, uint8_t b) {
+    // Build BRMesh command
+    uint8_t payload[12];
+    build_rgb_payload(payload, addr, r, g, b);
+    send_mesh_command(payload, 12);
+  }
+  
+  // True when the frame should go out: a visible change, the keepalive is due, or `force`
+  bool should_send_color(ColorGate &gate, uint8_t r, uint8_t g, uint8_t b, bool force) {
+    uint8_t rgb[3] = {r, g, b};
+    uint32_t now = millis();
+    if (!force && gate.sent && now - gate.time < keepalive_ms &&
+        color_distance(rgb, gate.rgb) < color_threshold) {
+      frames_suppressed++;
+      return false;
+    }
+    memcpy(gate.rgb, rgb, sizeof(rgb));
+    gate.time = now;
+    gate.sent = true;
+    return true;
   }
   
   void send_mesh_command(uint8_t *payload, size_t len) {
-    if (controller != nullptr) {
-      std::vector<uint8_t> data(payload, payload + len);
+    if (scheduler != nullptr) {
+      // Overwrites the target's frame slot; only the newest frame ever reaches the radio.
       // Send as broadcast (0xFFFF) since the payload contains the target address
-      controller->send_raw_command(0xFFFF, data);
+      uint16_t target = (payload[1] << 8) | payload[2];
+      scheduler->submit_effect(target, 0xFFFF, payload, len);
       ESP_LOGV("music-udp", "Sent color command via mesh");
     } else {
       ESP_LOGW("music-udp", "Controller not set, cannot send mesh command");
@@ -345,46 +844,151 @@ class MusicReactiveEffectUDP : public esphome::Component {
   }
   
   void update_sensors() {
-    bass_sensor->publish_state(bass_level * 100.0);
-    mid_sensor->publish_state(mid_level * 100.0);
-    treble_sensor->publish_state(treble_level * 100.0);
+    audio->publish_sensors(shown);
   }
   
   // Control methods
   void start() {
+    // The core only captures while a master is running
+    if (is_master && !running) audio->acquire();
     running = true;
     ESP_LOGI("music-udp", "%s mode started", is_master ? "Master" : "Slave");
   }
   
   void stop() {
+    if (is_master && running) audio->release();
     running = false;
     ESP_LOGI("music-udp", "%s mode stopped", is_master ? "Master" : "Slave");
   }
   
+  // Capture and analysis settings live in the shared core (see audio_core.h)
+  void set_capture_task(bool enable) {
+    audio->set_capture_task(enable);
+  }
+  
+  void set_num_bands(int bands) {
+    audio->set_num_bands(bands);
+  }
+  
+  void set_streaming_capture(bool enable, float overlap) {
+    audio->set_streaming_capture(enable, overlap);
+  }
+  
+  // Send light commands only when a beat is detected instead of every frame
+  void set_beat_sync(bool enable) {
+    beat_sync = enable;
+  }
+  
+  // Onset threshold in standard deviations above the recent mean flux (default 1.5)
+  void set_beat_sensitivity(float k) {
+    audio->set_beat_sensitivity(k);
+    onset_detector.threshold_k = k;
+  }
+  
   void enable_udp_broadcast(bool enable) {
     udp_enabled = enable;
     ESP_LOGI("music-udp", "UDP broadcast %s", enable ? "enabled" : "disabled");
   }
   
   void set_sensitivity(float sens) {
-    sensitivity = sens;
+    audio->set_sensitivity(sens);
+  }
+  
+  void set_auto_gain(bool enable) {
+    audio->set_auto_gain(enable);
+  }
+  
+  // threshold: minimum redmean distance worth sending (0 sends every frame)
+  void set_send_threshold(float threshold, uint32_t keepalive) {
+    color_threshold = threshold;
+    keepalive_ms = keepalive;
+  }
+  
+  // Off handles one datagram per loop (the old behaviour)
+  void set_drain_packets(bool enable) {
+    drain_packets = enable;
+  }
+  
+  // How far behind the master's clock frames are rendered; must cover the worst WiFi
+  // latency between master and slaves. 0 renders on arrival (no cross-node sync)
+  void set_playout_delay(uint32_t delay_ms) {
+    playout_delay_ms = delay_ms;
+  }
+  
+  // Wire format the master sends; slaves accept all of them
+  void set_sync_protocol(SyncProtocol protocol) {
+    sync_protocol = protocol;
+  }
+  
+  // Add a light to the per-light table. hue is 0-1 (< 0 = by position); for
+  // MAP_SPECTRUM without a bin range the spectrum is split evenly along the table.
+  void add_light_mapping(uint16_t addr, MapSource source, float hue = -1.0, int first_bin = -1, int last_bin = -1) {
+    if (light_map.size() >= MAX_MAPPED_LIGHTS) {
+      ESP_LOGW("music-udp", "Light table full, ignoring 0x%04X", addr);
+      return;
+    }
+    LightMapping light = {};
+    light.addr[0] = addr >> 8;
+    light.addr[1] = addr & 0xFF;
+    light.source = source;
+    light.first_bin = first_bin;
+    light.last_bin = last_bin < 0 ? first_bin : last_bin;
+    light.hue = hue;
+    light_map.push_back(light);
+  }
+  
+  void add_spectrum_fixture(uint16_t addr, int first_bin = -1, int last_bin = -1) {
+    add_light_mapping(addr, MAP_SPECTRUM, -1.0, first_bin, last_bin);
+  }
+  
+  // Spectrum of the frame on the lights, 0-1 with peak hold
+  float get_spectrum_level(int bin) {
+    return bin >= 0 && bin < MAX_SPECTRUM_BANDS ? spectrum_display[bin] : 0.0;
   }
   
   void set_color_mode(const char *mode) {
     color_mode = String(mode);
   }
   
+  // Slaves ignore packets from any other sender once this is set
   void set_master_ip(const char *ip) {
     master_ip = String(ip);
+    filter_master = master_addr.fromString(ip);
+    if (!filter_master) {
+      ESP_LOGW("music-udp", "Invalid master IP '%s', accepting any sender", ip);
+      return;
+    }
     ESP_LOGI("music-udp", "Master IP set to %s", ip);
   }
   
+  // Set before the network comes up; the socket is opened once WiFi connects
+  void set_transport(SyncTransport mode) {
+    transport = mode;
+  }
+  
+  void set_multicast_group(const char *group) {
+    if (!multicast_group.fromString(group)) {
+      ESP_LOGW("music-udp", "Invalid multicast group '%s'", group);
+    }
+  }
+  
+  // Slave address for TRANSPORT_UNICAST; call once per slave
+  void add_unicast_target(const char *ip) {
+    IPAddress addr;
+    if (!addr.fromString(ip)) {
+      ESP_LOGW("music-udp", "Invalid unicast target '%s'", ip);
+      return;
+    }
+    unicast_targets.push_back(addr);
+  }
+  
   String get_status() {
+    // Rates are packets per second over the last profiling window, not one packet gap
     if (is_master) {
-      return "Broadcasting";
+      return "Broadcasting (" + String(packet_rate, 1) + " fps)";
     } else {
       if (millis() - last_packet_time < 2000) {
-        return "Receiving (" + String((int)(1000.0 / (millis() - last_packet_time))) + " fps)";
+        return "Receiving (" + String(packet_rate, 1) + " fps, " + String(loss_percent, 1) + "% lost)";
       } else {
         return "No signal";
       }
@@ -395,7 +999,37 @@ class MusicReactiveEffectUDP : public esphome::Component {
     return packet_count;
   }
   
-  esphome::sensor::Sensor *get_bass_sensor() { return bass_sensor; }
-  esphome::sensor::Sensor *get_mid_sensor() { return mid_sensor; }
-  esphome::sensor::Sensor *get_treble_sensor() { return treble_sensor; }
+  unsigned long get_frames_suppressed() {
+    return frames_suppressed;
+  }
+  
+  unsigned long get_packets_reordered() { return packets_reordered; }
+  unsigned long get_packets_lost() { return packets_lost; }
+  unsigned long get_packets_discarded() { return packets_discarded; }
+  unsigned long get_packets_foreign() { return packets_foreign; }
+  float get_jitter_ms() { return jitter_ms; }
+  int32_t get_clock_offset() { return clock_offset; }
+  unsigned long get_frames_late() { return frames_late; }
+  
+  // Profiling, last PROFILE_WINDOW_MS window; for template sensors, e.g.
+  // `return id(music_effect)->get_fft_stats().max_us;`
+  StageStats get_capture_stats() { return audio->get_capture_stats(); }
+  StageStats get_fft_stats() { return audio->get_fft_stats(); }
+  StageStats get_mapping_stats() { return mapping_timer.last(); }
+  StageStats get_send_stats() { return send_timer.last(); }
+  StageStats get_receive_stats() { return receive_timer.last(); }
+  StageStats get_frame_stats() { return frame_timer.last(); }
+  unsigned long get_frame_overruns() { return frame_overruns; }
+  float get_packet_rate() { return packet_rate; }
+  float get_loss_percent() { return loss_percent; }
+  
+  float get_bpm() { return bpm; }
+  uint32_t get_beat_count() { return beat_count; }
+  bool is_beat() { return beat_now; }
+  
+  // The core's sensors, shared with any other music effect in the firmware
+  esphome::sensor::Sensor *get_bass_sensor() { return audio->get_bass_sensor(); }
+  esphome::sensor::Sensor *get_mid_sensor() { return audio->get_mid_sensor(); }
+  esphome::sensor::Sensor *get_treble_sensor() { return audio->get_treble_sensor(); }
+  esphome::sensor::Sensor *get_bpm_sensor() { return audio->get_bpm_sensor(); }
 };
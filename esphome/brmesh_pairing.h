@@ -4,33 +4,137 @@
  * 
  * Protocol:
  * - Lights advertise manufacturer data 0xf0ff when unpaired
+ * - While pairing is enabled, scan results are matched in parse_devices() and
+ *   new lights are added automatically
  * - Data format: [DeviceID:6][LightID:2][MeshKey:4]
+ * - Adverts from lights that are already paired update their smoothed RSSI, so the
+ *   add-on can route each light through the bridge with the best link
  * - Mesh key is typically "0236" (ASCII: 30323336)
  * - Encryption key: "5e367bc4"
  */
 
 #include "esphome.h"
+#include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
 #include <vector>
 #include <string>
 #include <Preferences.h>
 
+#define BRMESH_MANUFACTURER_ID 0xf0ff
+#define PAIRING_DATA_LEN 12     // [DeviceID:6][LightID:2][MeshKey:4]
+
+#define RSSI_UNKNOWN -999       // No advert seen from the light since boot
+#define RSSI_SMOOTHING 0.25f    // EMA weight of a new sample (~4 adverts to settle)
+#define RSSI_STALE_MS 120000    // A light not heard this long drops out of the report
+
+// Flash layout: a small header blob plus the records in fixed-size chunk blobs, each
+// chunk followed by a CRC32. Pairing one light rewrites its chunk and the header only,
+// and boot is 1 + N/LIGHTS_PER_CHUNK NVS reads instead of four per light.
+#define STORE_MAGIC 0x424D      // "BM"
+#define STORE_VERSION 1
+#define LIGHTS_PER_CHUNK 16
+
+struct __attribute__((packed)) StoreHeader {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t record_size;
+  uint16_t count;
+};
+
+struct __attribute__((packed)) StoredLight {
+  uint8_t mac[6];
+  uint8_t device_id[6];
+  uint16_t light_id;
+  uint8_t mesh_key[4];
+};
+
 struct PairedLight {
-  std::string mac_address;
-  std::string device_id;
+  uint64_t mac;               // 48-bit MAC, first octet in the most significant byte
+  uint8_t device_id[6];
   uint16_t light_id;
-  std::string mesh_key;
+  uint8_t mesh_key[4];
   unsigned long paired_time;
-  int rssi;
+  float rssi;                 // Smoothed over scan adverts, RSSI_UNKNOWN until the first one
+  uint32_t last_seen;         // millis() of the last advert
+};
+
+// Open-addressing hash from a key (MAC or light ID) to a position in paired_lights.
+// Lights are only ever appended or all cleared, so there is no deletion; the table
+// stays at most half full and is rebuilt at twice the size when it would pass that.
+class LightIndex {
+ public:
+  static const uint16_t EMPTY = 0xFFFF;
+  
+  void clear() {
+    slots.clear();
+    used = 0;
+  }
+  
+  // Position of the first light inserted with `key`, -1 if none
+  int find(uint64_t key) const {
+    if (slots.empty()) return -1;
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+      if (slots[i].pos == EMPTY) return -1;
+      if (slots[i].key == key) return slots[i].pos;
+    }
+  }
+  
+  void insert(uint64_t key, uint16_t pos) {
+    if ((used + 1) * 2 > slots.size()) grow();
+    place(key, pos);
+    used++;
+  }
+  
+ private:
+  struct Slot {
+    uint64_t key;
+    uint16_t pos;
+  };
+  std::vector<Slot> slots;    // Size is a power of two
+  size_t used = 0;
+  
+  static size_t hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key;
+  }
+  
+  void place(uint64_t key, uint16_t pos) {
+    size_t mask = slots.size() - 1;
+    size_t i = hash(key) & mask;
+    while (slots[i].pos != EMPTY) i = (i + 1) & mask;
+    slots[i].key = key;
+    slots[i].pos = pos;
+  }
+  
+  void grow() {
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(max((size_t)16, old.size() * 2), Slot{0, EMPTY});
+    for (const auto &slot : old) {
+      if (slot.pos != EMPTY) place(slot.key, slot.pos);
+    }
+  }
 };
 
-class BRMeshPairing : public Component {
+#define ID_BITMAP_WORDS 8       // Light IDs 0-255 tracked in the free-ID bitmap
+
+class BRMeshPairing : public Component, public esp32_ble_tracker::ESPBTDeviceListener {
  private:
   bool pairing_enabled = false;
   std::vector<PairedLight> paired_lights;
   Preferences prefs;
   
+  // Lookup indexes, kept in step with paired_lights
+  LightIndex mac_index;
+  LightIndex id_index;
+  uint32_t id_bitmap[ID_BITMAP_WORDS] = {0};  // Bit set = light ID in use
+  uint16_t max_light_id = 0;
+  
   const char* PREF_NAMESPACE = "brmesh";
-  const char* PREF_COUNT_KEY = "light_count";
+  const char* PREF_COUNT_KEY = "light_count";    // Old per-light string layout, migrated on load
+  const char* PREF_HEADER_KEY = "lights";
   
  public:
   void setup() override {
@@ -38,6 +142,11 @@ class BRMeshPairing : public Component {
     prefs.begin(PREF_NAMESPACE, false);
     load_paired_lights();
     
+    // Scan results come straight from the tracker, see parse_devices()
+    if (esp32_ble_tracker::global_esp32_ble_tracker != nullptr) {
+      esp32_ble_tracker::global_esp32_ble_tracker->register_listener(this);
+    }
+    
     ESP_LOGI("pairing", "BRMesh Pairing initialized");
     ESP_LOGI("pairing", "Loaded %d paired lights from flash", paired_lights.size());
   }
@@ -57,34 +166,120 @@ class BRMeshPairing : public Component {
     ESP_LOGI("pairing", "Pairing mode disabled");
   }
   
+  // The tracker only hands raw scan results to listeners that ask for them; as a parsed
+  // listener it would never call parse_devices() and would build an ESPBTDevice per advert
+  esp32_ble_tracker::AdvertisementParserType get_advertisement_parser_type() override {
+    return esp32_ble_tracker::AdvertisementParserType::RAW_ADVERTISEMENTS;
+  }
+  
+  // Raw scan results in bulk. Adverts from paired lights are found with one MAC index
+  // lookup and only feed their RSSI; while pairing, everything else that isn't a BRMesh
+  // pairing advert is rejected by walking its AD structures in place, before any
+  // ESPBTDevice or string is built.
+  bool parse_devices(esp_ble_gap_cb_param_t::ble_scan_result_evt_param *advertisements, size_t count) override {
+    if (!pairing_enabled && paired_lights.empty()) return false;
+    uint32_t now = millis();
+    for (size_t i = 0; i < count; i++) {
+      const auto &adv = advertisements[i];
+      if (PairedLight *light = find_light(mac_from_bytes(adv.bda))) {
+        update_rssi(*light, adv.rssi, now);
+        continue;
+      }
+      if (!pairing_enabled) continue;
+      const uint8_t *data = find_pairing_data(adv.ble_adv, adv.adv_data_len + adv.scan_rsp_len);
+      if (data != nullptr) {
+        handle_pairing_advert(adv.bda, adv.rssi, data);
+      }
+    }
+    // Not consumed: the other listeners still get their parsed devices
+    return false;
+  }
+  
+  bool parse_device(const esp32_ble_tracker::ESPBTDevice &device) override {
+    return false;
+  }
+  
+  // Payload of the 0xf0ff manufacturer data field if present and long enough, else nullptr
+  static const uint8_t *find_pairing_data(const uint8_t *adv, size_t len) {
+    size_t pos = 0;
+    while (pos + 1 < len) {
+      uint8_t field_len = adv[pos];
+      if (field_len == 0 || pos + 1 + field_len > len) return nullptr;  // Padding or malformed
+      
+      // [type][company ID][payload]. Lights put the ID on air as f0 ff, which ESPHome
+      // reports as 0xfff0, so both byte orders are accepted
+      const uint8_t *field = adv + pos + 1;
+      if (field[0] == ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE && field_len >= 3 + PAIRING_DATA_LEN) {
+        uint16_t company = (field[1] << 8) | field[2];
+        if (company == BRMESH_MANUFACTURER_ID || company == 0xfff0) return field + 3;
+      }
+      pos += 1 + field_len;
+    }
+    return nullptr;
+  }
+  
+  void handle_pairing_advert(const uint8_t *bda, int rssi, const uint8_t *data) {
+    uint64_t mac = mac_from_bytes(bda);
+    // A light keeps advertising until it has joined; don't log every repeat
+    if (find_light(mac) != nullptr) return;
+    
+    ESP_LOGI("pairing", "Found BRMesh device %s (RSSI: %d dBm)", mac_to_string(mac).c_str(), rssi);
+    uint16_t light_id = data[6] | (data[7] << 8);
+    add_light(mac, data, light_id, data + 8);
+    if (PairedLight *light = find_light(mac)) {
+      update_rssi(*light, rssi, millis());
+    }
+  }
+  
+  static void update_rssi(PairedLight &light, int rssi, uint32_t now) {
+    if (light.rssi == RSSI_UNKNOWN || now - light.last_seen > RSSI_STALE_MS) {
+      light.rssi = rssi;        // First sample, or the old average no longer says anything
+    } else {
+      light.rssi += (rssi - light.rssi) * RSSI_SMOOTHING;
+    }
+    light.last_seen = now;
+  }
+  
   void add_light(const char* mac, const char* device_id, uint16_t light_id, const char* mesh_key) {
+    uint8_t mac_bytes[6], device_bytes[6], key_bytes[4];
+    parse_hex(mac, mac_bytes, sizeof(mac_bytes));
+    parse_hex(device_id, device_bytes, sizeof(device_bytes));
+    parse_hex(mesh_key, key_bytes, sizeof(key_bytes));
+    add_light(mac_from_bytes(mac_bytes), device_bytes, light_id, key_bytes);
+  }
+  
+  void add_light(uint64_t mac, const uint8_t *device_id, uint16_t light_id, const uint8_t *mesh_key) {
     // Check if already paired
-    for (auto& light : paired_lights) {
-      if (light.mac_address == mac) {
-        ESP_LOGW("pairing", "Light %s already paired (ID: %d)", mac, light.light_id);
-        return;
-      }
+    if (PairedLight *existing = find_light(mac)) {
+      ESP_LOGW("pairing", "Light %s already paired (ID: %d)", mac_to_string(mac).c_str(), existing->light_id);
+      return;
+    }
+    if (find_light_by_id(light_id) != nullptr) {
+      ESP_LOGW("pairing", "Light ID %d is already used by another light", light_id);
     }
     
     // Add new light
     PairedLight light;
-    light.mac_address = mac;
-    light.device_id = device_id;
+    light.mac = mac;
+    memcpy(light.device_id, device_id, sizeof(light.device_id));
     light.light_id = light_id;
-    light.mesh_key = mesh_key;
+    memcpy(light.mesh_key, mesh_key, sizeof(light.mesh_key));
     light.paired_time = millis();
-    light.rssi = -999;
+    light.rssi = RSSI_UNKNOWN;
+    light.last_seen = 0;
     
     paired_lights.push_back(light);
+    index_light(paired_lights.size() - 1);
     
     ESP_LOGI("pairing", "✓ Successfully paired light!");
-    ESP_LOGI("pairing", "  MAC: %s", mac);
-    ESP_LOGI("pairing", "  Device ID: %s", device_id);
+    ESP_LOGI("pairing", "  MAC: %s", mac_to_string(mac).c_str());
+    ESP_LOGI("pairing", "  Device ID: %s", to_hex(light.device_id, sizeof(light.device_id), false).c_str());
     ESP_LOGI("pairing", "  Light ID: %d", light_id);
-    ESP_LOGI("pairing", "  Mesh Key: %s", mesh_key);
+    ESP_LOGI("pairing", "  Mesh Key: %s", to_hex(light.mesh_key, sizeof(light.mesh_key), false).c_str());
     
-    // Save to flash
-    save_paired_lights();
+    // Save to flash; only the chunk holding the new record is rewritten
+    save_chunk((paired_lights.size() - 1) / LIGHTS_PER_CHUNK);
+    save_header();
     
     // Generate next available light ID for convenience
     ESP_LOGI("pairing", "");
@@ -92,68 +287,253 @@ class BRMeshPairing : public Component {
     ESP_LOGI("pairing", "Total paired lights: %d", paired_lights.size());
   }
   
+  PairedLight *find_light(uint64_t mac) {
+    int pos = mac_index.find(mac);
+    return pos < 0 ? nullptr : &paired_lights[pos];
+  }
+  
+  PairedLight *find_light_by_id(uint16_t light_id) {
+    int pos = id_index.find(light_id);
+    return pos < 0 ? nullptr : &paired_lights[pos];
+  }
+  
+  void index_light(size_t pos) {
+    const PairedLight &light = paired_lights[pos];
+    mac_index.insert(light.mac, pos);
+    id_index.insert(light.light_id, pos);
+    if (light.light_id < ID_BITMAP_WORDS * 32) {
+      id_bitmap[light.light_id / 32] |= 1u << (light.light_id % 32);
+    }
+    max_light_id = max(max_light_id, light.light_id);
+  }
+  
+  static uint64_t mac_from_bytes(const uint8_t *bytes) {
+    uint64_t mac = 0;
+    for (int i = 0; i < 6; i++) mac = (mac << 8) | bytes[i];
+    return mac;
+  }
+  
+  static void mac_to_bytes(uint64_t mac, uint8_t *bytes) {
+    for (int i = 5; i >= 0; i--) {
+      bytes[i] = mac & 0xFF;
+      mac >>= 8;
+    }
+  }
+  
+  static std::string mac_to_string(uint64_t mac) {
+    uint8_t bytes[6];
+    mac_to_bytes(mac, bytes);
+    return to_hex(bytes, sizeof(bytes), true);
+  }
+  
   void clear_all_lights() {
+    size_t chunks = (paired_lights.size() + LIGHTS_PER_CHUNK - 1) / LIGHTS_PER_CHUNK;
     paired_lights.clear();
-    prefs.putUInt(PREF_COUNT_KEY, 0);
+    mac_index.clear();
+    id_index.clear();
+    memset(id_bitmap, 0, sizeof(id_bitmap));
+    max_light_id = 0;
+    save_header();
+    for (size_t c = 0; c < chunks; c++) {
+      char key[16];
+      sprintf(key, "lights_%d", c);
+      prefs.remove(key);
+    }
     ESP_LOGI("pairing", "All paired lights cleared");
   }
   
+  // Lowest free light ID (ID 0 is never handed out); past the bitmap, one above the highest
   uint16_t get_next_light_id() {
-    uint16_t max_id = 0;
-    for (auto& light : paired_lights) {
-      if (light.light_id > max_id) {
-        max_id = light.light_id;
+    for (int w = 0; w < ID_BITMAP_WORDS; w++) {
+      uint32_t free_ids = ~id_bitmap[w];
+      if (w == 0) free_ids &= ~1u;
+      if (free_ids != 0) return w * 32 + __builtin_ctz(free_ids);
+    }
+    return max_light_id + 1;
+  }
+  
+  static uint32_t crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+      crc ^= data[i];
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
       }
     }
-    return max_id + 1;
+    return ~crc;
   }
   
-  void save_paired_lights() {
-    prefs.putUInt(PREF_COUNT_KEY, paired_lights.size());
+  // Hex string to bytes; separators such as ':' are skipped
+  static void parse_hex(const std::string &hex, uint8_t *out, size_t len) {
+    memset(out, 0, len);
+    size_t n = 0;
+    int high = -1;
+    for (char c : hex) {
+      int v = isdigit(c) ? c - '0' : (isxdigit(c) ? (tolower(c) - 'a' + 10) : -1);
+      if (v < 0) continue;
+      if (high < 0) {
+        high = v;
+      } else {
+        if (n == len) return;
+        out[n++] = (high << 4) | v;
+        high = -1;
+      }
+    }
+  }
+  
+  static std::string to_hex(const uint8_t *data, size_t len, bool mac_format) {
+    std::string hex;
+    char buf[4];
+    for (size_t i = 0; i < len; i++) {
+      if (mac_format) {
+        sprintf(buf, i == 0 ? "%02X" : ":%02X", data[i]);
+      } else {
+        sprintf(buf, "%02x", data[i]);
+      }
+      hex += buf;
+    }
+    return hex;
+  }
+  
+  void save_header() {
+    StoreHeader header = {STORE_MAGIC, STORE_VERSION, sizeof(StoredLight), (uint16_t)paired_lights.size()};
+    prefs.putBytes(PREF_HEADER_KEY, &header, sizeof(header));
+  }
+  
+  // Write one chunk of records followed by its CRC
+  void save_chunk(size_t chunk) {
+    uint8_t buf[LIGHTS_PER_CHUNK * sizeof(StoredLight) + sizeof(uint32_t)];
+    size_t first = chunk * LIGHTS_PER_CHUNK;
+    size_t count = min(paired_lights.size() - first, (size_t)LIGHTS_PER_CHUNK);
     
-    for (size_t i = 0; i < paired_lights.size(); i++) {
-      char key[32];
-      
-      sprintf(key, "mac_%d", i);
-      prefs.putString(key, paired_lights[i].mac_address.c_str());
-      
-      sprintf(key, "devid_%d", i);
-      prefs.putString(key, paired_lights[i].device_id.c_str());
-      
-      sprintf(key, "lightid_%d", i);
-      prefs.putUShort(key, paired_lights[i].light_id);
-      
-      sprintf(key, "meshkey_%d", i);
-      prefs.putString(key, paired_lights[i].mesh_key.c_str());
+    for (size_t i = 0; i < count; i++) {
+      const PairedLight &light = paired_lights[first + i];
+      StoredLight record;
+      mac_to_bytes(light.mac, record.mac);
+      memcpy(record.device_id, light.device_id, sizeof(record.device_id));
+      record.light_id = light.light_id;
+      memcpy(record.mesh_key, light.mesh_key, sizeof(record.mesh_key));
+      memcpy(buf + i * sizeof(StoredLight), &record, sizeof(record));
+    }
+    size_t len = count * sizeof(StoredLight);
+    uint32_t crc = crc32(buf, len);
+    memcpy(buf + len, &crc, sizeof(crc));
+    
+    char key[16];
+    sprintf(key, "lights_%d", chunk);
+    prefs.putBytes(key, buf, len + sizeof(crc));
+  }
+  
+  void save_paired_lights() {
+    size_t chunks = (paired_lights.size() + LIGHTS_PER_CHUNK - 1) / LIGHTS_PER_CHUNK;
+    for (size_t c = 0; c < chunks; c++) {
+      save_chunk(c);
     }
+    save_header();
     
     ESP_LOGD("pairing", "Saved %d lights to flash", paired_lights.size());
   }
   
   void load_paired_lights() {
+    StoreHeader header;
+    if (prefs.getBytes(PREF_HEADER_KEY, &header, sizeof(header)) != sizeof(header)) {
+      migrate_legacy_lights();
+      return;
+    }
+    if (header.magic != STORE_MAGIC || header.version != STORE_VERSION ||
+        header.record_size != sizeof(StoredLight)) {
+      ESP_LOGE("pairing", "Unknown paired light storage format (version %d)", header.version);
+      return;
+    }
+    
+    uint8_t buf[LIGHTS_PER_CHUNK * sizeof(StoredLight) + sizeof(uint32_t)];
+    size_t chunks = (header.count + LIGHTS_PER_CHUNK - 1) / LIGHTS_PER_CHUNK;
+    paired_lights.reserve(header.count);
+    for (size_t c = 0; c < chunks; c++) {
+      size_t expected = min(header.count - c * LIGHTS_PER_CHUNK, (size_t)LIGHTS_PER_CHUNK);
+      char key[16];
+      sprintf(key, "lights_%d", c);
+      
+      // The chunk is written before the header, so after a reset in between it can hold one
+      // record more than the header counts. Check the CRC over what the chunk says it holds
+      // and load the records both agree on.
+      uint32_t crc;
+      size_t size = prefs.getBytes(key, buf, sizeof(buf));
+      if (size < sizeof(crc) || (size - sizeof(crc)) % sizeof(StoredLight) != 0) {
+        ESP_LOGE("pairing", "Paired light chunk %d missing or truncated", c);
+        continue;
+      }
+      size_t len = size - sizeof(crc);
+      memcpy(&crc, buf + len, sizeof(crc));
+      if (crc != crc32(buf, len)) {
+        ESP_LOGE("pairing", "Paired light chunk %d failed CRC check, skipping %d lights", c, expected);
+        continue;
+      }
+      size_t count = min(len / sizeof(StoredLight), expected);
+      if (count < expected) {
+        ESP_LOGW("pairing", "Paired light chunk %d holds %d of %d lights", c, count, expected);
+      }
+      
+      for (size_t i = 0; i < count; i++) {
+        StoredLight record;
+        memcpy(&record, buf + i * sizeof(StoredLight), sizeof(record));
+        PairedLight light;
+        light.mac = mac_from_bytes(record.mac);
+        memcpy(light.device_id, record.device_id, sizeof(light.device_id));
+        light.light_id = record.light_id;
+        memcpy(light.mesh_key, record.mesh_key, sizeof(light.mesh_key));
+        light.paired_time = 0;
+        light.rssi = RSSI_UNKNOWN;
+        light.last_seen = 0;
+        paired_lights.push_back(light);
+        index_light(paired_lights.size() - 1);
+      }
+    }
+  }
+  
+  // Read the old four-strings-per-light layout once, rewrite it as chunks, drop the old keys
+  void migrate_legacy_lights() {
     uint32_t count = prefs.getUInt(PREF_COUNT_KEY, 0);
+    if (count == 0) return;
     
     for (uint32_t i = 0; i < count; i++) {
       PairedLight light;
       char key[32];
+      uint8_t mac[6];
       
       sprintf(key, "mac_%d", i);
-      light.mac_address = prefs.getString(key, "").c_str();
+      parse_hex(prefs.getString(key, "").c_str(), mac, sizeof(mac));
+      light.mac = mac_from_bytes(mac);
       
       sprintf(key, "devid_%d", i);
-      light.device_id = prefs.getString(key, "").c_str();
+      parse_hex(prefs.getString(key, "").c_str(), light.device_id, sizeof(light.device_id));
       
       sprintf(key, "lightid_%d", i);
       light.light_id = prefs.getUShort(key, 0);
       
       sprintf(key, "meshkey_%d", i);
-      light.mesh_key = prefs.getString(key, "").c_str();
+      parse_hex(prefs.getString(key, "").c_str(), light.mesh_key, sizeof(light.mesh_key));
       
       light.paired_time = 0;
-      light.rssi = -999;
+      light.rssi = RSSI_UNKNOWN;
+      light.last_seen = 0;
       
       paired_lights.push_back(light);
+      index_light(paired_lights.size() - 1);
     }
+    
+    // The old keys only go once the new layout is fully written
+    save_paired_lights();
+    for (uint32_t i = 0; i < count; i++) {
+      char key[32];
+      const char *formats[] = {"mac_%d", "devid_%d", "lightid_%d", "meshkey_%d"};
+      for (const char *format : formats) {
+        sprintf(key, format, i);
+        prefs.remove(key);
+      }
+    }
+    prefs.remove(PREF_COUNT_KEY);
+    ESP_LOGI("pairing", "Migrated %d paired lights to the binary format", count);
   }
   
   void export_config() {
@@ -164,10 +544,10 @@ class BRMeshPairing : public Component {
     ESP_LOGI("pairing", "lights:");
     
     for (auto& light : paired_lights) {
-      ESP_LOGI("pairing", "  - mac_address: \"%s\"", light.mac_address.c_str());
-      ESP_LOGI("pairing", "    device_id: \"%s\"", light.device_id.c_str());
+      ESP_LOGI("pairing", "  - mac_address: \"%s\"", mac_to_string(light.mac).c_str());
+      ESP_LOGI("pairing", "    device_id: \"%s\"", to_hex(light.device_id, sizeof(light.device_id), false).c_str());
       ESP_LOGI("pairing", "    light_id: %d", light.light_id);
-      ESP_LOGI("pairing", "    mesh_key: \"%s\"", light.mesh_key.c_str());
+      ESP_LOGI("pairing", "    mesh_key: \"%s\"", to_hex(light.mesh_key, sizeof(light.mesh_key), false).c_str());
       ESP_LOGI("pairing", "    name: \"Light %d\"  # Customize this", light.light_id);
       ESP_LOGI("pairing", "");
     }
@@ -194,7 +574,7 @@ class BRMeshPairing : public Component {
     for (size_t i = 0; i < paired_lights.size(); i++) {
       result += std::to_string(i + 1) + ". ";
       result += "ID:" + std::to_string(paired_lights[i].light_id) + " ";
-      result += "(" + paired_lights[i].mac_address + ")";
+      result += "(" + mac_to_string(paired_lights[i].mac) + ")";
       if (i < paired_lights.size() - 1) {
         result += ", ";
       }
@@ -202,6 +582,20 @@ class BRMeshPairing : public Component {
     return result;
   }
   
+  // Smoothed RSSI of every light heard recently as "id:rssi,id:rssi", e.g. "10:-62,11:-78".
+  // Kept short so a few dozen lights still fit in one 255 character text sensor state.
+  std::string get_rssi_report() {
+    std::string result;
+    uint32_t now = millis();
+    char buf[16];
+    for (const auto &light : paired_lights) {
+      if (light.rssi == RSSI_UNKNOWN || now - light.last_seen > RSSI_STALE_MS) continue;
+      sprintf(buf, "%s%d:%d", result.empty() ? "" : ",", light.light_id, (int)lroundf(light.rssi));
+      result += buf;
+    }
+    return result;
+  }
+  
   int get_light_count() {
     return paired_lights.size();
   }
@@ -1,8 +1,8 @@
 #include <algorithm>
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 #include "fastcon_light_optimized.h"
 #include "fastcon_controller.h"
-#include "utils.h"
 
 namespace esphome
 {
@@ -24,6 +24,59 @@ namespace esphome
         void FastconLight::set_controller(FastconController *controller)
         {
             this->controller_ = controller;
+            this->scheduler_ = FastconScheduler::for_controller(controller);
+            this->scheduler_->register_light(this);
+        }
+
+        void FastconLight::record_dedup_hit_()
+        {
+            dedup_hits_++;
+            this->scheduler_->record_dedup_hit();
+        }
+
+        void FastconLight::mark_sent(uint32_t now)
+        {
+            committed_light_data_ = pending_light_data_;
+            last_command_sent_ = now;
+        }
+
+        FastconTransitionTransformer::~FastconTransitionTransformer()
+        {
+            // A new call replaces the transformer without stop()
+            this->light_->set_transitioning(false);
+        }
+
+        void FastconTransitionTransformer::start()
+        {
+            light::LightTransitionTransformer::start();
+            this->light_->set_transitioning(true);
+            this->stepped_ = false;
+            this->final_stepped_ = false;
+        }
+
+        optional<light::LightColorValues> FastconTransitionTransformer::apply()
+        {
+            // Only as many steps as the scheduler can put on air; the final one always goes out
+            uint32_t now = millis();
+            bool final_step = this->get_progress_() >= 1.0f;
+            if (!final_step && this->stepped_ && now - this->last_step_ < this->light_->get_step_interval_ms())
+                return {};
+
+            this->last_step_ = now;
+            this->stepped_ = true;
+            this->final_stepped_ = final_step;
+            return light::LightTransitionTransformer::apply();
+        }
+
+        void FastconTransitionTransformer::stop()
+        {
+            this->light_->set_transitioning(false);
+            light::LightTransitionTransformer::stop();
+        }
+
+        std::unique_ptr<light::LightTransformer> FastconLight::create_default_transition()
+        {
+            return make_unique<FastconTransitionTransformer>(this);
         }
 
         light::LightTraits FastconLight::get_traits()
@@ -43,45 +96,42 @@ namespace esphome
 
             uint32_t now = millis();
             
-            // Check if debounce period has elapsed
+            // Check if debounce period has elapsed (adapts to radio load); transition steps
+            // are already paced by FastconTransitionTransformer and go out right away
             uint32_t time_since_change = now - last_state_change_;
-            if (time_since_change < DEBOUNCE_MS)
+            if (!transitioning_ && time_since_change < this->scheduler_->get_debounce_ms())
                 return;
             
-            // Check if minimum interval between commands has elapsed
+            // Check if this light's share of airtime allows another command
             uint32_t time_since_sent = now - last_command_sent_;
-            if (time_since_sent < MIN_INTERVAL_MS)
+            if (time_since_sent < this->scheduler_->get_min_interval_ms())
                 return;
 
             // **OPTIMIZATION: Command deduplication**
-            // Skip if command is identical to last sent command
-            if (pending_data_ == last_sent_data_)
+            // Skip if the state settled back to what was last sent
+            if (pending_light_data_ == committed_light_data_)
             {
                 ESP_LOGV(TAG, "Skipping duplicate command for light %d", light_id_);
+                record_dedup_hit_();
                 has_pending_command_ = false;
                 return;
             }
 
-            // Send the pending command
             ESP_LOGD(TAG, "Sending debounced command for light %d (delayed %dms)", light_id_, time_since_change);
-            
-            // Debug output - print payload as hex
-            auto hex_str = vector_to_hex_string(pending_data_).data();
-            ESP_LOGD(TAG, "Advertisement Payload (%d bytes): %s", pending_data_.size(), hex_str);
 
-            // Send the advertisement
-            this->controller_->queueCommand(this->light_id_, pending_data_);
-            
-            // Update tracking
-            last_sent_data_ = pending_data_;
-            last_command_sent_ = now;
+            // **OPTIMIZATION: Group coalescing**
+            // The scheduler builds the advert (or a shared broadcast), queues it and calls mark_sent()
+            submitted_at_ = now;
+            this->scheduler_->record_debounce_wait(now - pending_since_);
+            this->scheduler_->submit(this);
             has_pending_command_ = false;
         }
 
         void FastconLight::write_state(light::LightState *state)
         {
             // Get the light data bits from the state
-            auto light_data = this->controller_->get_light_data(state);
+            this->controller_->get_light_data(state, light_data_scratch_);
+            const auto &light_data = light_data_scratch_;
 
             // Debug output - print the light state values
             bool is_on = (light_data[0] & 0x80) != 0;
@@ -101,12 +151,27 @@ namespace esphome
                          light_id_, is_on, brightness, r, g, b, warm, cold);
             }
 
-            // Generate the advertisement payload
-            auto adv_data = this->controller_->single_control(this->light_id_, light_data);
+            // **OPTIMIZATION: Early deduplication**
+            // Compare the compact light data before any encryption happens; HA re-publishes
+            // unchanged states constantly and those must not cost a single_control() call.
+            // Always compare with the pending state: mark_sent() copies it into the committed
+            // state, so the two only differ while a command is in flight, and a change back to
+            // the committed state must still replace a command sitting in the scheduler.
+            LightData next;
+            next.assign(light_data);
+            if (next == pending_light_data_)
+            {
+                ESP_LOGV(TAG, "State unchanged for light %d, nothing to send", light_id_);
+                record_dedup_hit_();
+                return;
+            }
 
             // **OPTIMIZATION: Instead of sending immediately, mark as pending**
-            pending_data_ = adv_data;
+            // The advert itself is only generated by the scheduler when the command goes out
+            pending_light_data_ = next;
             last_state_change_ = millis();
+            if (!has_pending_command_)
+                pending_since_ = last_state_change_;
             has_pending_command_ = true;
             
             ESP_LOGV(TAG, "Command pending for light %d, will send after debounce", light_id_);
@@ -1,10 +1,12 @@
 #pragma once
 
-#include <array>
 #include <vector>
 #include "esphome/core/component.h"
 #include "esphome/components/light/light_output.h"
+#include "esphome/components/light/transformers.h"
 #include "fastcon_controller.h"
+#include "fastcon_payload.h"
+#include "fastcon_scheduler.h"
 
 namespace esphome
 {
@@ -17,6 +19,35 @@ namespace esphome
             RGB
         };
 
+        class FastconLight;
+
+        // **OPTIMIZATION: On-device transitions paced by the airtime scheduler**
+        // ESPHome's transition interpolates on every loop, and every step reset the light's
+        // debounce, so nothing went out until the fade had finished. This one emits a step only
+        // when the light's share of airtime allows another command, always emits the final
+        // value, and marks the light as transitioning so steps skip the debounce. The
+        // interpolation runs on LightColorValues, which are gamma-encoded (gamma is applied
+        // when the light data is built), so the steps are evenly spaced in perceived brightness.
+        class FastconTransitionTransformer : public light::LightTransitionTransformer
+        {
+        public:
+            explicit FastconTransitionTransformer(FastconLight *light) : light_(light) {}
+            ~FastconTransitionTransformer() override;
+
+            void start() override;
+            optional<light::LightColorValues> apply() override;
+            // Only once the final value has been returned; LightState checks this after
+            // apply(), and the end of the transition may pass in between
+            bool is_finished() override { return this->final_stepped_; }
+            void stop() override;
+
+        protected:
+            FastconLight *light_;
+            uint32_t last_step_{0};
+            bool stepped_{false};
+            bool final_stepped_{false};
+        };
+
         class FastconLight : public Component, public light::LightOutput
         {
         public:
@@ -26,21 +57,44 @@ namespace esphome
             void loop() override;  // Add loop for debouncing
             light::LightTraits get_traits() override;
             void write_state(light::LightState *state) override;
+            std::unique_ptr<light::LightTransformer> create_default_transition() override;
             void set_controller(FastconController *controller);
 
+            // Accessors used by FastconScheduler when coalescing commands
+            uint8_t get_light_id() const { return light_id_; }
+            const LightData &get_pending_light_data() const { return pending_light_data_; }
+            const LightData &get_committed_light_data() const { return committed_light_data_; }
+            uint32_t get_last_state_change() const { return last_state_change_; }
+            uint32_t get_pending_since() const { return pending_since_; }
+            uint32_t get_submitted_at() const { return submitted_at_; }
+            uint32_t get_dedup_hits() const { return dedup_hits_; }
+            void mark_sent(uint32_t now);
+
+            // Set by FastconTransitionTransformer while a transition is running
+            void set_transitioning(bool transitioning) { transitioning_ = transitioning; }
+            bool is_transitioning() const { return transitioning_; }
+            uint32_t get_step_interval_ms() const { return this->scheduler_->get_min_interval_ms(); }
+
         protected:
+            void record_dedup_hit_();
+
             FastconController *controller_{nullptr};
+            FastconScheduler *scheduler_{nullptr};
             uint8_t light_id_;
             
             // **OPTIMIZATION: State tracking and debouncing**
-            std::vector<uint8_t> last_sent_data_;       // Track last command sent
-            std::vector<uint8_t> pending_data_;         // Pending command to send
+            // Inline buffers so state updates never touch the heap
+            LightData pending_light_data_;              // Pending light state to send
+            LightData committed_light_data_;            // Track last light state sent
+            std::vector<uint8_t> light_data_scratch_;   // get_light_data() output, keeps its capacity
             uint32_t last_state_change_{0};             // Time of last write_state() call
             uint32_t last_command_sent_{0};             // Time of last actual BLE command
             bool has_pending_command_{false};           // Flag for pending command
-            
-            static const uint32_t DEBOUNCE_MS = 100;    // Wait 100ms before sending
-            static const uint32_t MIN_INTERVAL_MS = 300; // Minimum 300ms between commands (matches throttle)
+            uint32_t pending_since_{0};                 // First write_state() of the pending command
+            uint32_t submitted_at_{0};                  // Time the command was handed to the scheduler
+            uint32_t dedup_hits_{0};                    // States that never had to be sent
+            bool transitioning_{false};                 // Steps are already paced, skip the debounce
+            // Debounce and minimum interval come from the controller's FastconScheduler
         };
     } // namespace fastcon
 } // namespace esphome
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace esphome
+{
+    namespace fastcon
+    {
+        // Fixed-capacity byte buffer stored inline (no heap), used for the per-light
+        // command state so HA slider drags don't allocate on every write_state().
+        template <size_t N>
+        class InlineBuffer
+        {
+        public:
+            static constexpr size_t CAPACITY = N;
+
+            InlineBuffer() = default;
+
+            void assign(const uint8_t *data, size_t len)
+            {
+                size_ = static_cast<uint8_t>(std::min(len, N));
+                std::memcpy(data_.data(), data, size_);
+            }
+            void assign(const std::vector<uint8_t> &data) { assign(data.data(), data.size()); }
+            void clear() { size_ = 0; }
+
+            const uint8_t *data() const { return data_.data(); }
+            uint8_t *data() { return data_.data(); }
+            size_t size() const { return size_; }
+            bool empty() const { return size_ == 0; }
+            const uint8_t *begin() const { return data_.data(); }
+            const uint8_t *end() const { return data_.data() + size_; }
+            uint8_t operator[](size_t i) const { return data_[i]; }
+
+            bool operator==(const InlineBuffer &other) const
+            {
+                return size_ == other.size_ && std::memcmp(data_.data(), other.data_.data(), size_) == 0;
+            }
+            bool operator!=(const InlineBuffer &other) const { return !(*this == other); }
+
+        protected:
+            std::array<uint8_t, N> data_{};
+            uint8_t size_{0};
+        };
+
+        // Compact light state from get_light_data(): 1 byte (on/brightness) or 6 bytes (full color)
+        using LightData = InlineBuffer<8>;
+        // Finished advertisement payload; a legacy BLE advert carries at most 31 bytes
+        using AdvPayload = InlineBuffer<31>;
+    } // namespace fastcon
+} // namespace esphome
@@ -0,0 +1,485 @@
+#include <algorithm>
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "fastcon_scheduler.h"
+#include "fastcon_light_optimized.h"
+
+namespace esphome
+{
+    namespace fastcon
+    {
+        static const char *const TAG = "fastcon.scheduler";
+
+        std::vector<FastconScheduler *> &FastconScheduler::registry_()
+        {
+            static std::vector<FastconScheduler *> schedulers;
+            return schedulers;
+        }
+
+        FastconScheduler *FastconScheduler::find(FastconController *controller)
+        {
+            for (auto *scheduler : registry_())
+            {
+                if (scheduler->controller_ == controller)
+                    return scheduler;
+            }
+            return nullptr;
+        }
+
+        FastconScheduler *FastconScheduler::for_controller(FastconController *controller)
+        {
+            if (auto *scheduler = find(controller))
+                return scheduler;
+
+            // Lights bind their controller during code generation, before App.setup(),
+            // so registering here still puts the scheduler in the component loop.
+            auto *scheduler = new FastconScheduler(controller);
+            App.register_component(scheduler);
+            registry_().push_back(scheduler);
+            return scheduler;
+        }
+
+        void FastconScheduler::register_light(FastconLight *light)
+        {
+            if (std::find(lights_.begin(), lights_.end(), light) == lights_.end())
+                lights_.push_back(light);
+        }
+
+        void FastconScheduler::submit(FastconLight *light)
+        {
+            if (pending_.empty())
+                window_start_ = millis();
+
+            // A light re-submitting within the window just replaces its earlier state
+            if (std::find(pending_.begin(), pending_.end(), light) == pending_.end())
+                pending_.push_back(light);
+        }
+
+        void FastconScheduler::set_broadcast_address(uint32_t address)
+        {
+            broadcast_address_ = address;
+            has_broadcast_address_ = true;
+            broadcast_enabled_ = true;
+        }
+
+        void FastconScheduler::add_group(uint32_t address, const std::vector<uint8_t> &light_ids)
+        {
+            groups_.push_back({address, light_ids});
+        }
+
+        FastconLight *FastconScheduler::find_light_(uint8_t light_id) const
+        {
+            for (auto *light : lights_)
+            {
+                if (light->get_light_id() == light_id)
+                    return light;
+            }
+            return nullptr;
+        }
+
+        void FastconScheduler::setup()
+        {
+            // Read once: burst mode changes the controller's adv_duration later on
+            adv_duration_ms_ = this->controller_->get_adv_duration();
+            adv_gap_ms_ = this->controller_->get_adv_gap();
+            max_queue_size_ = this->controller_->get_max_queue_size();
+            slot_ms_ = normal_slot_ms_ = std::max<uint32_t>(adv_duration_ms_ + adv_gap_ms_, 1);
+            min_interval_ms_ = slot_ms_;
+            ESP_LOGCONFIG(TAG, "Airtime slot %ums, queue size %u", (unsigned) slot_ms_, (unsigned) max_queue_size_);
+        }
+
+        void FastconScheduler::set_mesh_key(std::array<uint8_t, 4> key)
+        {
+            this->controller_->set_mesh_key(key);
+            invalidate_command_cache();
+        }
+
+        void FastconScheduler::invalidate_command_cache()
+        {
+            for (auto &entry : command_cache_)
+                entry.valid = false;
+        }
+
+        const std::vector<uint8_t> &FastconScheduler::encrypt_(uint32_t light_id, const LightData &light_data)
+        {
+            // The key can also be changed on the controller directly, behind set_mesh_key()
+            auto mesh_key = this->controller_->get_mesh_key();
+            if (mesh_key != cache_mesh_key_)
+            {
+                invalidate_command_cache();
+                cache_mesh_key_ = mesh_key;
+            }
+
+            cache_clock_++;
+            CachedAdvert *victim = &command_cache_[0];
+            for (auto &entry : command_cache_)
+            {
+                if (entry.valid && entry.light_id == light_id && entry.light_data == light_data)
+                {
+                    cache_hits_++;
+                    entry.last_used = cache_clock_;
+                    adv_scratch_.assign(entry.adv.begin(), entry.adv.end());
+                    this->controller_->restamp_sequence(adv_scratch_);
+                    return adv_scratch_;
+                }
+                if (!entry.valid || (victim->valid && entry.last_used < victim->last_used))
+                    victim = &entry;
+            }
+
+            cache_misses_++;
+            light_data_scratch_.assign(light_data.begin(), light_data.end());
+            this->controller_->single_control(light_id, light_data_scratch_, adv_scratch_);
+
+            // An advert that wouldn't fit the inline buffer is simply not cached
+            if (adv_scratch_.size() <= AdvPayload::CAPACITY)
+            {
+                victim->light_id = light_id;
+                victim->light_data = light_data;
+                victim->adv.assign(adv_scratch_);
+                victim->last_used = cache_clock_;
+                victim->valid = true;
+            }
+            return adv_scratch_;
+        }
+
+        void FastconScheduler::submit_effect(uint16_t target, uint32_t addr, const uint8_t *data, size_t len)
+        {
+            write_effect_slot_(target, addr, data, len, millis());
+        }
+
+        void FastconScheduler::submit_effect_batch(uint32_t addr, const EffectCommand *commands, size_t count)
+        {
+            if (count == 0)
+                return;
+
+            uint32_t now = millis();
+            size_t first = write_effect_slot_(commands[0].target, addr, commands[0].data, commands[0].len, now);
+            for (size_t i = 1; i < count; i++)
+                write_effect_slot_(commands[i].target, addr, commands[i].data, commands[i].len, now);
+
+            // A batch's slots are allocated in its order on first use and keep their
+            // positions, so restarting the cursor at the first entry sends it in order
+            next_effect_slot_ = first;
+        }
+
+        size_t FastconScheduler::write_effect_slot_(uint16_t target, uint32_t addr, const uint8_t *data, size_t len, uint32_t now)
+        {
+            EffectSlot *slot = nullptr;
+            for (size_t i = 0; i < effect_slot_count_; i++)
+            {
+                if (effect_slots_[i].target == target)
+                {
+                    slot = &effect_slots_[i];
+                    break;
+                }
+            }
+
+            if (slot == nullptr)
+            {
+                if (effect_slot_count_ < MAX_EFFECT_TARGETS)
+                {
+                    slot = &effect_slots_[effect_slot_count_++];
+                }
+                else
+                {
+                    // Out of slots: take over the one written longest ago
+                    slot = &effect_slots_[0];
+                    for (size_t i = 1; i < effect_slot_count_; i++)
+                    {
+                        if (now - effect_slots_[i].written_at > now - slot->written_at)
+                            slot = &effect_slots_[i];
+                    }
+                }
+                slot->target = target;
+            }
+
+            if (slot->dirty)
+                effects_superseded_++;
+
+            slot->addr = addr;
+            slot->data.assign(data, len);
+            slot->dirty = true;
+            slot->written_at = now;
+            return slot - effect_slots_.data();
+        }
+
+        void FastconScheduler::loop()
+        {
+            uint32_t now = millis();
+            update_burst_(now);
+            update_pacing_(now);
+            roll_stats_(now);
+
+            if (pending_.empty())
+            {
+                send_effect_(now);
+                return;
+            }
+
+            // Nothing to coalesce with while only one light is busy, so don't hold it back
+            if (active_lights_ > 1 && now - window_start_ < COALESCE_WINDOW_MS)
+                return;
+
+            flush_(now);
+        }
+
+        uint32_t FastconScheduler::backlog_ms_(uint32_t now) const
+        {
+            int32_t backlog = static_cast<int32_t>(air_free_at_ - now);
+            return backlog > 0 ? static_cast<uint32_t>(backlog) : 0;
+        }
+
+        void FastconScheduler::roll_stats_(uint32_t now)
+        {
+            if (now - window_started_ < STATS_WINDOW_MS)
+                return;
+            last_window_ = window_;
+            window_.clear();
+            window_started_ = now;
+        }
+
+        void FastconScheduler::record_queued_(FastconLight *light, uint32_t now)
+        {
+            // Called right before the light's advert is queued: it goes on air once the
+            // controller has worked through the backlog in front of it
+            uint32_t on_air = now + backlog_ms_(now);
+            window_.queue_wait.record(now - light->get_submitted_at());
+            window_.time_to_air.record(on_air - light->get_pending_since());
+        }
+
+        void FastconScheduler::update_burst_(uint32_t now)
+        {
+            if (burst_adv_duration_ms_ == 0 || burst_adv_duration_ms_ >= adv_duration_ms_)
+                return;
+
+            // Demand = adverts on the controller + commands and frames still to be handed over
+            size_t waiting = backlog_ms_(now) / slot_ms_ + pending_.size();
+            for (size_t i = 0; i < effect_slot_count_; i++)
+            {
+                if (effect_slots_[i].dirty)
+                    waiting++;
+            }
+
+            // Enter on a real batch, leave only once it has fully drained, so the duration
+            // doesn't flip back and forth in the middle of a scene
+            bool burst = bursting_ ? waiting > 0 : waiting >= BURST_MIN_ADVERTS;
+            // No burst while a lone interactive command is still waiting to go on air
+            if (static_cast<int32_t>(full_duration_until_ - now) > 0)
+                burst = false;
+            if (burst == bursting_)
+                return;
+
+            set_bursting_(burst);
+            ESP_LOGV(TAG, "Burst advertising %s (%d adverts waiting)", burst ? "on" : "off", waiting);
+        }
+
+        void FastconScheduler::set_bursting_(bool burst)
+        {
+            bursting_ = burst;
+            uint16_t duration = burst ? burst_adv_duration_ms_ : adv_duration_ms_;
+            this->controller_->set_adv_duration(duration);
+            slot_ms_ = burst ? duration + adv_gap_ms_ : normal_slot_ms_;
+        }
+
+        void FastconScheduler::update_pacing_(uint32_t now)
+        {
+            active_lights_ = 0;
+            for (auto *light : lights_)
+            {
+                if (now - light->get_last_state_change() < ACTIVE_WINDOW_MS)
+                    active_lights_++;
+            }
+
+            // Fair share: with N lights competing, each may use at most every Nth slot.
+            // A single active light gets back-to-back slots, i.e. the radio limit.
+            min_interval_ms_ = slot_ms_ * std::max<size_t>(active_lights_, 1);
+
+            // Wait longer for state to settle while the radio is still busy anyway;
+            // extra updates collapse into one command instead of queueing behind each other
+            debounce_ms_ = std::min(std::max(backlog_ms_(now), MIN_DEBOUNCE_MS), MAX_DEBOUNCE_MS);
+        }
+
+        bool FastconScheduler::can_broadcast_(const LightData &light_data) const
+        {
+            if (!broadcast_enabled_ || pending_.size() < 2)
+                return false;
+
+            for (auto *light : pending_)
+            {
+                if (light->get_pending_light_data() != light_data)
+                    return false;
+            }
+
+            // Lights that are not pending must already be in the target state,
+            // otherwise the broadcast would change them too
+            for (auto *light : lights_)
+            {
+                if (std::find(pending_.begin(), pending_.end(), light) != pending_.end())
+                    continue;
+                if (light->get_committed_light_data() != light_data)
+                    return false;
+            }
+            return true;
+        }
+
+        void FastconScheduler::flush_groups_(uint32_t now)
+        {
+            for (const auto &group : groups_)
+            {
+                if (pending_.size() < 2)
+                    return;
+
+                // Only usable when every member ends up in one state: pending members share
+                // it, the others already have it. Undeclared members are an unknown state.
+                const LightData *state = nullptr;
+                size_t pending_members = 0;
+                bool usable = true;
+                for (uint8_t light_id : group.light_ids)
+                {
+                    auto *light = find_light_(light_id);
+                    if (light == nullptr)
+                    {
+                        usable = false;
+                        break;
+                    }
+                    if (std::find(pending_.begin(), pending_.end(), light) == pending_.end())
+                        continue;
+                    if (state == nullptr)
+                        state = &light->get_pending_light_data();
+                    else if (light->get_pending_light_data() != *state)
+                        usable = false;
+                    pending_members++;
+                }
+                if (!usable || pending_members < 2)
+                    continue;
+                for (uint8_t light_id : group.light_ids)
+                {
+                    auto *light = find_light_(light_id);
+                    bool pending = std::find(pending_.begin(), pending_.end(), light) != pending_.end();
+                    if (!pending && light->get_committed_light_data() != *state)
+                        usable = false;
+                }
+                if (!usable)
+                    continue;
+
+                ESP_LOGD(TAG, "Coalesced %d lights into one command for group %u", pending_members, group.address);
+                LightData light_data = *state;
+                const auto &adv_data = encrypt_(group.address, light_data);
+                for (uint8_t light_id : group.light_ids)
+                {
+                    auto *light = find_light_(light_id);
+                    auto it = std::find(pending_.begin(), pending_.end(), light);
+                    if (it == pending_.end())
+                        continue;
+                    record_queued_(light, now);
+                    light->mark_sent(now);
+                    pending_.erase(it);
+                }
+                queue_advert_(group.address, adv_data, now);
+            }
+        }
+
+        void FastconScheduler::queue_advert_(uint32_t light_id, const std::vector<uint8_t> &adv_data, uint32_t now)
+        {
+            size_t depth_before = this->controller_->get_queue_size();
+            this->controller_->queueCommand(light_id, adv_data);
+            if (check_queued_(depth_before))
+                air_free_at_ = std::max(air_free_at_, now) + slot_ms_;
+        }
+
+        bool FastconScheduler::check_queued_(size_t depth_before)
+        {
+            // The controller only pops its queue in its own loop(), so the depth includes the
+            // advert just handed over, and an unchanged depth means it dropped it (queue full)
+            size_t depth = this->controller_->get_queue_size();
+            if (depth == depth_before)
+            {
+                commands_dropped_++;
+                ESP_LOGW(TAG, "Controller queue full (%u), command dropped", (unsigned) depth);
+                return false;
+            }
+            window_.queue_depth_max = std::max(window_.queue_depth_max, depth);
+            queue_depth_max_ = std::max(queue_depth_max_, depth);
+            return true;
+        }
+
+        void FastconScheduler::send_effect_(uint32_t now)
+        {
+            // Only top up an (almost) idle radio, so an interactive command arriving next
+            // waits for at most one effect advert instead of a backlog of stale frames
+            if (effect_slot_count_ == 0 || backlog_ms_(now) >= slot_ms_)
+                return;
+
+            for (size_t n = 0; n < effect_slot_count_; n++)
+            {
+                auto &slot = effect_slots_[next_effect_slot_];
+                next_effect_slot_ = (next_effect_slot_ + 1) % effect_slot_count_;
+                if (!slot.dirty)
+                    continue;
+
+                effect_scratch_.assign(slot.data.begin(), slot.data.end());
+                size_t depth_before = this->controller_->get_queue_size();
+                this->controller_->send_raw_command(slot.addr, effect_scratch_);
+                if (check_queued_(depth_before))
+                    air_free_at_ = std::max(air_free_at_, now) + slot_ms_;
+                slot.dirty = false;
+                return;
+            }
+        }
+
+        void FastconScheduler::flush_(uint32_t now)
+        {
+            const auto &light_data = pending_.front()->get_pending_light_data();
+
+            if (can_broadcast_(light_data))
+            {
+                ESP_LOGD(TAG, "Coalesced %d lights into one broadcast command", pending_.size());
+                const auto &adv_data = encrypt_(this->broadcast_address_, light_data);
+                for (auto *light : pending_)
+                    record_queued_(light, now);
+                queue_advert_(this->broadcast_address_, adv_data, now);
+
+                for (auto *light : pending_)
+                    light->mark_sent(now);
+                pending_.clear();
+                return;
+            }
+
+            flush_groups_(now);
+
+            // Keep the controller queue at half its capacity at most so it never drops a
+            // command; whatever doesn't fit stays pending here in submission order
+            // Burst mode is for batches. The duration applies to the whole controller, so a
+            // single command arriving while music keeps the burst on would go out shortened;
+            // leave the burst and hold it off until this command has been on air.
+            bool lone_command = pending_.size() < BURST_MIN_ADVERTS;
+            if (lone_command && bursting_)
+                set_bursting_(false);
+
+            // At least one slot, or a max_queue_size of 0 or 1 would never let a unicast out
+            const uint32_t max_backlog_ms = slot_ms_ * std::max<size_t>(max_queue_size_ / 2, 1);
+            size_t sent = 0;
+            while (sent < pending_.size() && backlog_ms_(now) < max_backlog_ms)
+            {
+                auto *light = pending_[sent++];
+
+                // Encryption only happens here, once a command is actually going out,
+                // and only if this light hasn't been sent the same state recently
+                const auto &adv_data = encrypt_(light->get_light_id(), light->get_pending_light_data());
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+                // The hex dump allocates, so it is only compiled in at verbose log level
+                ESP_LOGV(TAG, "Advertisement Payload (%d bytes): %s", adv_data.size(),
+                         format_hex_pretty(adv_data.data(), adv_data.size()).c_str());
+#endif
+                record_queued_(light, now);
+                queue_advert_(light->get_light_id(), adv_data, now);
+                light->mark_sent(now);
+            }
+            pending_.erase(pending_.begin(), pending_.begin() + sent);
+            if (lone_command && burst_adv_duration_ms_ != 0)
+                full_duration_until_ = air_free_at_;
+        }
+    } // namespace fastcon
+} // namespace esphome
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "esphome/core/component.h"
+#include "fastcon_controller.h"
+#include "fastcon_payload.h"
+#include "fastcon_stats.h"
+
+namespace esphome
+{
+    namespace fastcon
+    {
+        class FastconLight;
+
+        // One entry of an effect batch, see FastconScheduler::submit_effect_batch()
+        struct EffectCommand
+        {
+            uint16_t target;
+            const uint8_t *data;
+            size_t len;
+        };
+
+        // Shared stage between all FastconLights of one controller and its command queue.
+        // Lights hand over their debounced commands here instead of queueing them directly,
+        // so a scene change that sets many lights to the same state goes out as one broadcast.
+        // It also owns the airtime budget: debounce and per-light send interval follow the
+        // current load instead of fixed constants.
+        //
+        // Traffic is split into two lanes. Interactive light commands always go first;
+        // streaming effect frames (music) only use slots the interactive lane leaves free,
+        // and a newer frame for the same target replaces an unsent older one.
+        class FastconScheduler : public Component
+        {
+        public:
+            // One scheduler per controller, created and registered on first use
+            static FastconScheduler *for_controller(FastconController *controller);
+            // Existing scheduler of a controller, nullptr if no light uses it (for YAML lambdas)
+            static FastconScheduler *find(FastconController *controller);
+
+            // Takes the airtime slot and queue size from the controller's fastcon: block
+            void setup() override;
+            void loop() override;
+            float get_setup_priority() const override { return setup_priority::DATA; }
+
+            void register_light(FastconLight *light);
+            void submit(FastconLight *light);
+
+            // Effect lane: latest frame per target wins, stale frames are dropped.
+            // `target` identifies the fixture/group the frame is for, `addr` is passed to send_raw_command()
+            void submit_effect(uint16_t target, uint32_t addr, const uint8_t *data, size_t len);
+            void submit_effect(uint16_t target, uint32_t addr, const std::vector<uint8_t> &data)
+            {
+                submit_effect(target, addr, data.data(), data.size());
+            }
+            // A whole frame for several targets at once. The entries go out back to back in
+            // the given order, starting with the first, so one frame reaches the lights as a
+            // single burst instead of interleaving with the previous frame's leftovers.
+            void submit_effect_batch(uint32_t addr, const EffectCommand *commands, size_t count);
+            // Frames replaced by a newer one for the same target before they were sent
+            uint32_t get_effects_superseded() const { return effects_superseded_; }
+
+            // Current pacing, recomputed every loop from the load on the radio
+            uint32_t get_debounce_ms() const { return debounce_ms_; }
+            uint32_t get_min_interval_ms() const { return min_interval_ms_; }
+
+            // Coalescing is opt-in, it needs addresses the lights are known to answer to.
+            // Broadcast: one advert for all lights, only used when every light on this
+            // controller ends up in the same state. It also reaches lights on the same mesh key
+            // that are not declared here (e.g. routed through another bridge), so only enable
+            // it when this controller owns the whole mesh.
+            void set_broadcast_address(uint32_t address);
+            void set_broadcast_enabled(bool enabled) { broadcast_enabled_ = enabled && has_broadcast_address_; }
+            // A group bound in the BRMesh app: when its pending members share a state and the
+            // others already have it, they go out as one advert to the group address.
+            // Every member must be a light declared on this controller.
+            void add_group(uint32_t address, const std::vector<uint8_t> &light_ids);
+            // Advert duration while a batch is waiting, 0 disables burst mode (the default)
+            void set_burst_adv_duration(uint16_t adv_duration_ms) { burst_adv_duration_ms_ = adv_duration_ms; }
+            bool is_bursting() const { return bursting_; }
+
+            // Changes the controller's mesh key; cached adverts were encrypted with the old one
+            void set_mesh_key(std::array<uint8_t, 4> key);
+            void invalidate_command_cache();
+            uint32_t get_cache_hits() const { return cache_hits_; }
+            uint32_t get_cache_misses() const { return cache_misses_; }
+
+            // **OPTIMIZATION: Always-on pipeline instrumentation**
+            // Histograms cover the last complete STATS_WINDOW_MS, so sensors polling them
+            // see recent behaviour instead of a since-boot average; counters are totals.
+            const PipelineStats &get_stats() const { return last_window_; }
+            size_t get_queue_depth_max() const { return queue_depth_max_; }
+            uint32_t get_dedup_hits() const { return dedup_hits_; }
+            // Commands and frames the controller refused because its queue was full
+            uint32_t get_commands_dropped() const { return commands_dropped_; }
+
+            // Reported by the lights
+            void record_dedup_hit() { dedup_hits_++; }
+            void record_debounce_wait(uint32_t ms) { window_.debounce_wait.record(ms); }
+
+        protected:
+            explicit FastconScheduler(FastconController *controller) : controller_(controller) {}
+
+            // **OPTIMIZATION: Latest-wins frame slots**
+            // One overwrite-on-write mailbox per effect target. Writing copies into the slot
+            // in place, so streaming frames never allocate and never pile up; the radio
+            // always picks up whatever is newest when it gets to that target.
+            struct EffectSlot
+            {
+                uint16_t target{0};
+                uint32_t addr{0};
+                AdvPayload data;
+                bool dirty{false};                      // Holds a frame not yet sent
+                uint32_t written_at{0};
+            };
+
+            static constexpr size_t MAX_EFFECT_TARGETS = 16;   // Effect lane capacity (distinct targets)
+
+            // **OPTIMIZATION: Pre-encrypted command cache**
+            // The advert for a given light and state only depends on the mesh key and the
+            // packet sequence byte, so the states sent over and over (on/off, full white, scene
+            // presets) are encrypted once and replayed from here. Every replay gets a fresh
+            // sequence number from the controller, and the cache is dropped as soon as the
+            // controller's mesh key no longer matches the one the entries were built with.
+            struct CachedAdvert
+            {
+                uint32_t light_id{0};
+                LightData light_data;
+                AdvPayload adv;
+                uint32_t last_used{0};                  // cache_clock_ value, oldest is evicted
+                bool valid{false};
+            };
+
+            static constexpr size_t COMMAND_CACHE_SIZE = 16;
+
+            size_t write_effect_slot_(uint16_t target, uint32_t addr, const uint8_t *data, size_t len, uint32_t now);
+            void update_pacing_(uint32_t now);
+            void update_burst_(uint32_t now);
+            void set_bursting_(bool burst);
+            void flush_(uint32_t now);
+            void send_effect_(uint32_t now);
+            bool can_broadcast_(const LightData &light_data) const;
+            void flush_groups_(uint32_t now);
+            FastconLight *find_light_(uint8_t light_id) const;
+            void queue_advert_(uint32_t light_id, const std::vector<uint8_t> &adv_data, uint32_t now);
+            const std::vector<uint8_t> &encrypt_(uint32_t light_id, const LightData &light_data);
+            uint32_t backlog_ms_(uint32_t now) const;
+            void record_queued_(FastconLight *light, uint32_t now);
+            bool check_queued_(size_t depth_before);
+            void roll_stats_(uint32_t now);
+            static std::vector<FastconScheduler *> &registry_();
+
+            FastconController *controller_;
+            std::vector<FastconLight *> lights_;        // All lights on this controller
+            std::vector<FastconLight *> pending_;       // Lights submitted in the current window
+            uint32_t window_start_{0};                  // Time of first submission in the window
+
+            // **OPTIMIZATION: Priority lanes**
+            std::array<EffectSlot, MAX_EFFECT_TARGETS> effect_slots_{};
+            size_t effect_slot_count_{0};
+            size_t next_effect_slot_{0};                // Round-robin cursor so no target starves
+            uint32_t effects_superseded_{0};            // Frames replaced before they reached the radio
+
+            // The controller API takes std::vector; these are only ever assigned in place or
+            // filled through the controller's out-parameter overloads, so they keep their
+            // capacity and handing a payload over doesn't allocate once warmed up
+            std::vector<uint8_t> light_data_scratch_;
+            std::vector<uint8_t> effect_scratch_;
+            std::vector<uint8_t> adv_scratch_;
+
+            std::array<CachedAdvert, COMMAND_CACHE_SIZE> command_cache_{};
+            std::array<uint8_t, 4> cache_mesh_key_{};  // Key the cached adverts were encrypted with
+            uint32_t cache_clock_{0};
+            uint32_t cache_hits_{0};
+            uint32_t cache_misses_{0};
+
+            PipelineStats window_;                      // Being filled
+            PipelineStats last_window_;                 // Last complete window, what getters report
+            uint32_t window_started_{0};
+            size_t queue_depth_max_{0};                 // Since boot
+            uint32_t commands_dropped_{0};              // Rejected by the controller, since boot
+            uint32_t dedup_hits_{0};
+
+            // **OPTIMIZATION: Group coalescing**
+            // Broadcasting reaches every light on the mesh key, so it is only used when
+            // every light on this controller ends up in the same state anyway; groups cover
+            // subsets (one room of a shared controller). Both are off until configured.
+            struct CoalesceGroup
+            {
+                uint32_t address;
+                std::vector<uint8_t> light_ids;
+            };
+
+            bool broadcast_enabled_{false};
+            bool has_broadcast_address_{false};
+            uint32_t broadcast_address_{0};             // Light address used for the broadcast form
+            std::vector<CoalesceGroup> groups_;
+
+            // **OPTIMIZATION: Airtime scheduling**
+            // Each queued advert occupies the radio for one slot; air_free_at_ tracks when the
+            // controller will have worked through everything handed to it so far.
+            uint32_t slot_ms_{0};                       // adv_duration + adv_gap, set in setup()
+            uint32_t normal_slot_ms_{0};                // slot_ms_ outside of a burst
+            size_t max_queue_size_{0};                  // The controller's max_queue_size
+            uint32_t air_free_at_{0};
+            size_t active_lights_{0};                   // Lights that changed state recently
+            uint32_t debounce_ms_{MAX_DEBOUNCE_MS};
+            uint32_t min_interval_ms_{0};
+
+            // **OPTIMIZATION: Burst advertising**
+            // A BRMesh command takes 24 of a legacy advert's 31 bytes, so an advert can't carry
+            // more than one. What a batch (scene recall, music frame) can do is go through the
+            // advert slots faster: while several adverts are waiting, each is advertised for
+            // burst_adv_duration_ms_ instead of the configured adv_duration. Lights scan
+            // continuously and catch a command in its first few advertising events, the
+            // longer duration is only margin for a single update on a noisy channel.
+            uint16_t adv_duration_ms_{0};               // Configured values, the controller's change during a burst
+            uint16_t adv_gap_ms_{0};
+            uint16_t burst_adv_duration_ms_{0};
+            bool bursting_{false};
+            uint32_t full_duration_until_{0};           // A lone interactive command is on air until then
+
+            static constexpr uint32_t COALESCE_WINDOW_MS = 50; // Collect submissions for 50ms before flushing
+            static constexpr size_t BURST_MIN_ADVERTS = 3;     // Waiting adverts that start a burst
+            static constexpr uint32_t MIN_DEBOUNCE_MS = 20;    // Debounce on an idle radio
+            static constexpr uint32_t MAX_DEBOUNCE_MS = 100;   // Debounce on a saturated radio
+            static constexpr uint32_t ACTIVE_WINDOW_MS = 1000; // A light counts as active this long after a change
+            static constexpr uint32_t STATS_WINDOW_MS = 60000; // Histogram window, matches a typical sensor update_interval
+        };
+    } // namespace fastcon
+} // namespace esphome
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace fastcon
+    {
+        // Fixed-size latency histogram with power-of-two millisecond buckets: bucket 0 holds
+        // 0ms, bucket i holds [2^(i-1), 2^i) ms and the last one everything slower. Recording
+        // is a couple of integer ops, so it stays enabled on the hot path at any log level.
+        class LatencyHistogram
+        {
+        public:
+            static constexpr size_t BUCKETS = 12;           // Last bucket starts at 1024ms
+
+            void record(uint32_t ms)
+            {
+                size_t bucket = ms == 0 ? 0 : std::min<size_t>(32 - __builtin_clz(ms), BUCKETS - 1);
+                buckets_[bucket]++;
+                count_++;
+                sum_ += ms;
+                max_ = std::max(max_, ms);
+            }
+
+            void clear() { *this = LatencyHistogram(); }
+
+            uint32_t count() const { return count_; }
+            uint32_t max() const { return max_; }
+            float mean() const { return count_ == 0 ? 0.0f : static_cast<float>(sum_) / count_; }
+
+            // Upper bound of the bucket the q-quantile falls into (capped at the observed max)
+            uint32_t percentile(float q) const
+            {
+                if (count_ == 0)
+                    return 0;
+                uint32_t rank = static_cast<uint32_t>(q * (count_ - 1)) + 1;
+                uint32_t seen = 0;
+                for (size_t i = 0; i < BUCKETS; i++)
+                {
+                    seen += buckets_[i];
+                    if (seen >= rank)
+                        return std::min<uint32_t>(i == 0 ? 0 : (1u << i) - 1, max_);
+                }
+                return max_;
+            }
+
+        protected:
+            std::array<uint32_t, BUCKETS> buckets_{};
+            uint32_t count_{0};
+            uint64_t sum_{0};
+            uint32_t max_{0};
+        };
+
+        // Where a light command spends its time, from write_state() to the radio:
+        //   debounce wait  write_state() -> handed to the scheduler
+        //   queue wait     handed to the scheduler -> queued on the controller
+        //   time to air    write_state() -> (estimated) start of its advert slot
+        struct PipelineStats
+        {
+            LatencyHistogram debounce_wait;
+            LatencyHistogram queue_wait;
+            LatencyHistogram time_to_air;
+            size_t queue_depth_max{0};                  // Adverts waiting on the controller, high-water mark
+
+            void clear() { *this = PipelineStats(); }
+        };
+    } // namespace fastcon
+} // namespace esphome
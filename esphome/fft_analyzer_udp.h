@@ -4,27 +4,17 @@
  * Slave: Receives FFT data over UDP, no microphone needed
  * 
  * Compatible with WLED sound sync protocol (port 11988)
+ *
+ * Capture, FFT, the 'AS' packet layout and the band sensors come from the shared audio
+ * core (components/music_reactive/audio_core.h, listed before this file in includes:).
+ * Slaves only use its sensors and never allocate the FFT buffers.
  */
 
 #include "esphome.h"
-#include "arduinoFFT.h"
 #include <WiFiUdp.h>
-#include <driver/i2s.h>
+#include "audio_core.h"
 
-#define SAMPLES 256
-#define SAMPLING_FREQUENCY 22050
-#define UDP_PORT 11988  // WLED sound sync port
-#define UDP_PACKET_SIZE 24  // FFT data packet size
-
-// UDP packet structure (compatible with WLED)
-struct AudioSyncPacket {
-  uint8_t header[2];        // 'A', 'S' (Audio Sync)
-  uint8_t volume;           // Overall volume 0-255
-  uint8_t bass;             // Bass level 0-255
-  uint8_t mid;              // Mid level 0-255
-  uint8_t treble;           // Treble level 0-255
-  uint8_t fft_bins[18];     // Simplified FFT spectrum (18 bins)
-};
+#define MAX_DRAIN_PACKETS 16  // Bounds the time one slave loop spends reading UDP
 
 class MusicReactiveEffectUDP : public Component, public Sensor {
  private:
@@ -35,57 +25,50 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
   WiFiUDP udp;
   IPAddress broadcast_ip;
   String master_ip = "";
+  IPAddress master_addr;              // Slaves only accept packets from here when set
+  bool filter_master = false;
+  unsigned long packets_foreign = 0;  // Dropped because they came from another master
   
-  // FFT data (master only)
-  arduinoFFT FFT = arduinoFFT();
-  double vReal[SAMPLES];
-  double vImag[SAMPLES];
-  const i2s_port_t I2S_PORT = I2S_NUM_0;
+  // Analysed frames (master) and the band sensors (both) come from the core
+  AudioCore *audio = AudioCore::get();
+  uint32_t levels_consumed = 0;
   
   // Frequency levels (both master and slave)
   float bass_level = 0.0;
   float mid_level = 0.0;
   float treble_level = 0.0;
   float volume = 0.0;
+  uint8_t fft_bins[18] = {0};
   
   // Settings
-  float sensitivity = 1.0;
   float update_rate = 10.0;
   uint8_t target_addr[2] = {0x2a, 0xa8};
   String color_mode = "RGB Frequency";
   
+  // Send-on-change: frames closer than color_threshold to the last sent color are
+  // dropped before they reach the mesh; keepalive_ms still refreshes a static color
+  float color_threshold = 8.0;    // Redmean distance, 0 - ~765
+  uint32_t keepalive_ms = 1000;
+  uint8_t last_sent_rgb[3] = {0, 0, 0};
+  uint32_t last_sent_time = 0;
+  bool color_sent = false;
+  unsigned long frames_suppressed = 0;
+  
   // Statistics
   unsigned long packet_count = 0;
   unsigned long last_packet_time = 0;
   unsigned long last_update = 0;
-  
-  // Sensors
-  Sensor *bass_sensor = new Sensor();
-  Sensor *mid_sensor = new Sensor();
-  Sensor *treble_sensor = new Sensor();
+  bool drain_packets = true;          // Read every queued datagram per loop, keep the newest
+  unsigned long packets_discarded = 0;
   
  public:
-  MusicReactiveEffectUDP(bool master_mode) : is_master(master_mode) {}
+  MusicReactiveEffectUDP(bool master_mode) : is_master(master_mode) {
+    if (is_master) audio->enable_capture();
+  }
   
   void setup() override {
     if (is_master) {
-      // Initialize I2S microphone
-      i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = SAMPLING_FREQUENCY,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = I2S_COMM_FORMAT_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 4,
-        .dma_buf_len = 1024,
-        .use_apll = false,
-        .tx_desc_auto_clear = false,
-        .fixed_mclk = 0
-      };
-      
-      i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
-      ESP_LOGI("music-udp", "Master mode: Microphone initialized");
+      ESP_LOGI("music-udp", "Master mode: Analysing audio from the shared core");
     } else {
       ESP_LOGI("music-udp", "Slave mode: Waiting for UDP packets");
     }
@@ -124,11 +107,16 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     unsigned long interval = 1000.0 / update_rate;
     
     if (now - last_update < interval) return;
-    last_update = now;
     
-    // Sample and analyze audio
-    sample_audio();
-    analyze_frequencies();
+    // Newest frame from the core (captured here if no other consumer got to it first)
+    AudioLevels levels;
+    if (!audio->read(levels, levels_consumed)) return;
+    bass_level = levels.bass;
+    mid_level = levels.mid;
+    treble_level = levels.treble;
+    volume = levels.volume;
+    memcpy(fft_bins, levels.fft_bins, sizeof(fft_bins));
+    last_update = now;
     
     // Broadcast FFT data over UDP
     if (udp_enabled) {
@@ -143,10 +131,23 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
   }
   
   void slave_loop() {
-    // Check for UDP packets
-    int packet_size = udp.parsePacket();
-    if (packet_size >= UDP_PACKET_SIZE) {
-      receive_audio_data();
+    // Empty the socket so latency can't build up when the master sends faster than we
+    // loop; each packet overwrites the levels, so the newest one is what gets rendered
+    int received = 0;
+    for (int reads = 0; reads < MAX_DRAIN_PACKETS; reads++) {
+      int packet_size = udp.parsePacket();
+      if (packet_size <= 0) break;
+      // Several zones can share a LAN; only follow our own master
+      if (filter_master && udp.remoteIP() != master_addr) {
+        packets_foreign++;
+        continue;
+      }
+      if (packet_size >= (int)sizeof(AudioSyncPacket) && receive_audio_data()) received++;
+      if (!drain_packets) break;
+    }
+    
+    if (received > 0) {
+      packets_discarded += received - 1;
       
       // Control lights based on received data
       unsigned long now = millis();
@@ -163,60 +164,6 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     }
   }
   
-  void sample_audio() {
-    size_t bytes_read = 0;
-    int32_t samples_buffer[SAMPLES];
-    
-    i2s_read(I2S_PORT, &samples_buffer, sizeof(samples_buffer), &bytes_read, portMAX_DELAY);
-    
-    for (int i = 0; i < SAMPLES; i++) {
-      vReal[i] = (double)samples_buffer[i] / 2147483648.0;
-      vImag[i] = 0.0;
-    }
-  }
-  
-  void analyze_frequencies() {
-    FFT.Windowing(vReal, SAMPLES, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
-    FFT.Compute(vReal, vImag, SAMPLES, FFT_FORWARD);
-    FFT.ComplexToMagnitude(vReal, vImag, SAMPLES);
-    
-    // Bass: 0-500Hz (bins 0-6)
-    bass_level = 0.0;
-    for (int i = 1; i <= 6; i++) {
-      bass_level += vReal[i];
-    }
-    bass_level /= 6.0;
-    
-    // Mid: 500-2000Hz (bins 6-23)
-    mid_level = 0.0;
-    for (int i = 6; i <= 23; i++) {
-      mid_level += vReal[i];
-    }
-    mid_level /= 18.0;
-    
-    // Treble: 2000-8000Hz (bins 23-93)
-    treble_level = 0.0;
-    for (int i = 23; i <= 93; i++) {
-      treble_level += vReal[i];
-    }
-    treble_level /= 71.0;
-    
-    // Overall volume
-    volume = (bass_level + mid_level + treble_level) / 3.0;
-    
-    // Apply sensitivity
-    bass_level *= sensitivity;
-    mid_level *= sensitivity;
-    treble_level *= sensitivity;
-    volume *= sensitivity;
-    
-    // Clamp
-    bass_level = constrain(bass_level, 0.0, 1.0);
-    mid_level = constrain(mid_level, 0.0, 1.0);
-    treble_level = constrain(treble_level, 0.0, 1.0);
-    volume = constrain(volume, 0.0, 1.0);
-  }
-  
   void broadcast_audio_data() {
     AudioSyncPacket packet;
     packet.header[0] = 'A';
@@ -226,11 +173,8 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     packet.mid = (uint8_t)(mid_level * 255.0);
     packet.treble = (uint8_t)(treble_level * 255.0);
     
-    // Simplified FFT bins for spectrum display
-    for (int i = 0; i < 18; i++) {
-      int fft_idx = (i * SAMPLES / 2) / 18;
-      packet.fft_bins[i] = (uint8_t)(constrain(vReal[fft_idx] * sensitivity * 255.0, 0.0, 255.0));
-    }
+    // Log-spaced spectrum from the core
+    memcpy(packet.fft_bins, fft_bins, sizeof(packet.fft_bins));
     
     // Broadcast to all devices on network
     udp.beginPacket(broadcast_ip, UDP_PORT);
@@ -238,14 +182,14 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     udp.endPacket();
   }
   
-  void receive_audio_data() {
+  bool receive_audio_data() {
     AudioSyncPacket packet;
     udp.read((uint8_t*)&packet, sizeof(AudioSyncPacket));
     
     // Verify header
     if (packet.header[0] != 'A' || packet.header[1] != 'S') {
       ESP_LOGW("music-udp", "Invalid packet header");
-      return;
+      return false;
     }
     
     // Extract frequency levels
@@ -254,12 +198,16 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     mid_level = packet.mid / 255.0;
     treble_level = packet.treble / 255.0;
     
+    // Keep the master's spectrum too; it persists until the next packet
+    memcpy(fft_bins, packet.fft_bins, sizeof(fft_bins));
+    
     // Update statistics
     packet_count++;
     last_packet_time = millis();
     
     ESP_LOGV("music-udp", "Received: Vol=%d Bass=%d Mid=%d Treble=%d", 
              packet.volume, packet.bass, packet.mid, packet.treble);
+    return true;
   }
   
   void send_color_command() {
@@ -288,6 +236,8 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
       }
     }
     
+    if (!should_send_color(r, g, b)) return;
+    
     // Build BRMesh command
     uint8_t payload[12] = {
       0x93, target_addr[0], target_addr[1], 0x04, 0xff,
@@ -297,29 +247,19 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     send_mesh_command(payload, 12);
   }
   
-  void hsv_to_rgb(float h, float s, float v, uint8_t &r, uint8_t &g, uint8_t &b) {
-    float c = v * s;
-    float x = c * (1.0 - fabs(fmod(h * 6.0, 2.0) - 1.0));
-    float m = v - c;
-    
-    float r_prime, g_prime, b_prime;
-    if (h < 0.166) {
-      r_prime = c; g_prime = x; b_prime = 0;
-    } else if (h < 0.333) {
-      r_prime = x; g_prime = c; b_prime = 0;
-    } else if (h < 0.5) {
-      r_prime = 0; g_prime = c; b_prime = x;
-    } else if (h < 0.666) {
-      r_prime = 0; g_prime = x; b_prime = c;
-    } else if (h < 0.833) {
-      r_prime = x; g_prime = 0; b_prime = c;
-    } else {
-      r_prime = c; g_prime = 0; b_prime = x;
+  // True when the frame should go out: a visible change, or the keepalive is due
+  bool should_send_color(uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t rgb[3] = {r, g, b};
+    uint32_t now = millis();
+    if (color_sent && now - last_sent_time < keepalive_ms &&
+        color_distance(rgb, last_sent_rgb) < color_threshold) {
+      frames_suppressed++;
+      return false;
     }
-    
-    r = (uint8_t)((r_prime + m) * 255.0);
-    g = (uint8_t)((g_prime + m) * 255.0);
-    b = (uint8_t)((b_prime + m) * 255.0);
+    memcpy(last_sent_rgb, rgb, sizeof(rgb));
+    last_sent_time = now;
+    color_sent = true;
+    return true;
   }
   
   void send_mesh_command(uint8_t *payload, size_t len) {
@@ -328,37 +268,65 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
   }
   
   void update_sensors() {
-    bass_sensor->publish_state(bass_level * 100.0);
-    mid_sensor->publish_state(mid_level * 100.0);
-    treble_sensor->publish_state(treble_level * 100.0);
+    AudioLevels levels = {};
+    levels.bass = bass_level;
+    levels.mid = mid_level;
+    levels.treble = treble_level;
+    levels.volume = volume;
+    audio->publish_sensors(levels);
   }
   
   // Control methods
   void start() {
+    // The core only captures while a master is running
+    if (is_master && !running) audio->acquire();
     running = true;
     ESP_LOGI("music-udp", "%s mode started", is_master ? "Master" : "Slave");
   }
   
   void stop() {
+    if (is_master && running) audio->release();
     running = false;
     ESP_LOGI("music-udp", "%s mode stopped", is_master ? "Master" : "Slave");
   }
   
+  // Must be set before setup(), i.e. right after constructing the component
+  void set_capture_task(bool enable) {
+    audio->set_capture_task(enable);
+  }
+  
   void enable_udp_broadcast(bool enable) {
     udp_enabled = enable;
     ESP_LOGI("music-udp", "UDP broadcast %s", enable ? "enabled" : "disabled");
   }
   
   void set_sensitivity(float sens) {
-    sensitivity = sens;
+    audio->set_sensitivity(sens);
+  }
+  
+  // Per-band AGC and noise floor; off falls back to sensitivity + hard clamp
+  void set_auto_gain(bool enable) {
+    audio->set_auto_gain(enable);
+  }
+  
+  // threshold: minimum redmean distance worth sending (0 sends every frame)
+  void set_send_threshold(float threshold, uint32_t keepalive) {
+    color_threshold = threshold;
+    keepalive_ms = keepalive;
   }
   
   void set_color_mode(const char *mode) {
     color_mode = String(mode);
   }
   
+  // Slaves ignore packets from any other sender once this is set
   void set_master_ip(const char *ip) {
     master_ip = String(ip);
+    filter_master = master_addr.fromString(ip);
+    if (!filter_master) {
+      ESP_LOGW("music-udp", "Invalid master IP '%s', accepting any sender", ip);
+      return;
+    }
     ESP_LOGI("music-udp", "Master IP set to %s", ip);
   }
   
@@ -378,7 +346,26 @@ class MusicReactiveEffectUDP : public Component, public Sensor {
     return packet_count;
   }
   
-  Sensor *get_bass_sensor() { return bass_sensor; }
-  Sensor *get_mid_sensor() { return mid_sensor; }
-  Sensor *get_treble_sensor() { return treble_sensor; }
+  // Latest received (slave) or computed (master) spectrum bin, 0-255
+  uint8_t get_fft_bin(int bin) {
+    return bin >= 0 && bin < 18 ? fft_bins[bin] : 0;
+  }
+  
+  unsigned long get_packets_discarded() {
+    return packets_discarded;
+  }
+  
+  // Off handles one datagram per loop (the old behaviour)
+  void set_drain_packets(bool enable) {
+    drain_packets = enable;
+  }
+  
+  unsigned long get_frames_suppressed() {
+    return frames_suppressed;
+  }
+  
+  // The core's sensors, shared by every music effect in the firmware
+  Sensor *get_bass_sensor() { return audio->get_bass_sensor(); }
+  Sensor *get_mid_sensor() { return audio->get_mid_sensor(); }
+  Sensor *get_treble_sensor() { return audio->get_treble_sensor(); }
 };
@@ -0,0 +1,2 @@
+// Compile check only: the legacy single-file analyzer still builds against the stubs
+#include "fft_analyzer.h"
@@ -0,0 +1,2 @@
+// Compile check only: the legacy UDP analyzer still builds against the stubs
+#include "fft_analyzer_udp.h"
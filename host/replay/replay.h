@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "esphome/core/application.h"
+#include "host.h"
+
+// Bits shared by the replay drivers: option parsing, the main loop and pass/fail checks
+namespace replay
+{
+    // --name value options plus positional arguments; flags given without a value read as "1"
+    class Args
+    {
+    public:
+        Args(int argc, char **argv)
+        {
+            for (int i = 1; i < argc; i++)
+            {
+                std::string arg = argv[i];
+                if (arg.rfind("--", 0) != 0)
+                {
+                    positional_.push_back(arg);
+                    continue;
+                }
+                bool has_value = i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0;
+                options_.push_back({arg.substr(2), has_value ? argv[++i] : "1"});
+            }
+        }
+
+        bool has(const std::string &name) const { return find_(name) != nullptr; }
+        std::string get(const std::string &name, const std::string &fallback = "") const
+        {
+            const std::string *value = find_(name);
+            return value != nullptr ? *value : fallback;
+        }
+        long get_int(const std::string &name, long fallback) const
+        {
+            const std::string *value = find_(name);
+            return value != nullptr ? std::strtol(value->c_str(), nullptr, 0) : fallback;
+        }
+        double get_float(const std::string &name, double fallback) const
+        {
+            const std::string *value = find_(name);
+            return value != nullptr ? std::strtod(value->c_str(), nullptr) : fallback;
+        }
+        // Every value of an option that may be repeated
+        std::vector<std::string> get_all(const std::string &name) const
+        {
+            std::vector<std::string> values;
+            for (const auto &option : options_)
+            {
+                if (option.first == name)
+                    values.push_back(option.second);
+            }
+            return values;
+        }
+        const std::vector<std::string> &positional() const { return positional_; }
+
+    private:
+        const std::string *find_(const std::string &name) const
+        {
+            for (auto it = options_.rbegin(); it != options_.rend(); ++it)
+            {
+                if (it->first == name)
+                    return &it->second;
+            }
+            return nullptr;
+        }
+
+        std::vector<std::pair<std::string, std::string>> options_;
+        std::vector<std::string> positional_;
+    };
+
+    // Thresholds from the command line; a replay exits non-zero if any of them failed
+    class Checks
+    {
+    public:
+        explicit Checks(const Args &args) : args_(args) {}
+
+        // --<option> N: fail when value > N
+        void at_most(const char *option, const char *what, double value)
+        {
+            if (!args_.has(option))
+                return;
+            double limit = args_.get_float(option, 0);
+            if (value > limit)
+                fail("%s is %.1f, limit %.1f (--%s)", what, value, limit, option);
+        }
+
+        // --<option> N: fail when value < N
+        void at_least(const char *option, const char *what, double value)
+        {
+            if (!args_.has(option))
+                return;
+            double limit = args_.get_float(option, 0);
+            if (value < limit)
+                fail("%s is %.1f, needs at least %.1f (--%s)", what, value, limit, option);
+        }
+
+        template <typename... T> void fail(const char *format, T... args)
+        {
+            printf("FAIL: ");
+            printf(format, args...);
+            printf("\n");
+            failed_ = true;
+        }
+
+        int exit_code() const
+        {
+            if (!failed_)
+                printf("OK\n");
+            return failed_ ? 1 : 0;
+        }
+
+    private:
+        const Args &args_;
+        bool failed_{false};
+    };
+
+    // One pass of every component's loop, then one virtual millisecond
+    inline void tick()
+    {
+        esphome::App.loop();
+        host::advance_ms(1);
+    }
+
+    inline void run_for(uint32_t ms)
+    {
+        uint32_t end = host::now_ms() + ms;
+        while (static_cast<int32_t>(host::now_ms() - end) < 0)
+            tick();
+    }
+
+    // q-quantile of the samples (sorts them)
+    inline uint32_t percentile(std::vector<uint32_t> &samples, double q)
+    {
+        if (samples.empty())
+            return 0;
+        std::sort(samples.begin(), samples.end());
+        size_t rank = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+        return samples[rank];
+    }
+
+    // Host CPU time of a scope, for the throughput line
+    class WallTimer
+    {
+    public:
+        WallTimer() : start_(std::chrono::steady_clock::now()) {}
+        double elapsed_ms() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    inline bool read_lines(const std::string &path, std::vector<std::string> &lines)
+    {
+        FILE *f = fopen(path.c_str(), "r");
+        if (f == nullptr)
+            return false;
+        char buf[1024];
+        while (fgets(buf, sizeof(buf), f) != nullptr)
+        {
+            std::string line = buf;
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            lines.push_back(line);
+        }
+        fclose(f);
+        return true;
+    }
+
+    inline void set_log_level(const Args &args)
+    {
+        // --verbose shows the components' debug logs, as on a device at the default level
+        host::set_log_level(args.has("verbose") ? 5 : 2);
+    }
+} // namespace replay
@@ -0,0 +1,258 @@
+// Replays recorded (or synthetic) microphone audio into a music_reactive master: shared
+// audio core, FFT, beat detection, per-light spectrum mapping and the scheduler's effect
+// lane on the fake controller. The master's sync packets can be recorded for replay_slave.
+//
+//   replay_audio [--wav file.wav | --tone HZ] [--mode blocking|streaming] [--overlap 0.5]
+//                [--protocol native|wled|legacy] [--bands 16] [--fixtures 6] [--seconds 25]
+//                [--record-packets file] [--verbose]
+//                [--expect-bpm N] [--bpm-tolerance 3] [--expect-peak-hz N] [--peak-tolerance 0.25]
+//                [--max-allocs N] [--max-lost-samples N] [--min-analyses N]
+//
+// Without --wav or --tone the input is a synthetic 120 BPM loop: kick on every beat, hi-hat
+// on the off-beats and a quiet 440Hz pad. A WAV file (16-bit PCM, any rate, first channel)
+// is resampled to the microphone rate and looped. --expect-peak-hz needs --protocol wled,
+// the only format that carries the FFT's major peak.
+
+#include <cmath>
+#include <cstring>
+#include "esphome/core/application.h"
+#include "fastcon_controller.h"
+#include "fastcon_scheduler.h"
+#include "host.h"
+#include "music_reactive.h"
+#include "replay.h"
+
+using namespace esphome;
+using namespace esphome::fastcon;
+
+namespace
+{
+    constexpr double PI = 3.14159265358979323846;
+    constexpr uint32_t WARMUP_MS = 5000;        // AGC and tempo settle, buffers are allocated
+
+    // Deterministic noise for the hi-hat, so runs are comparable
+    float noise(uint64_t n)
+    {
+        n = (n ^ (n >> 33)) * 0xff51afd7ed558ccdULL;
+        n = (n ^ (n >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+        return static_cast<float>(n >> 40) / (1 << 23) - 1.0f;
+    }
+
+    float synthetic_beat(uint64_t index)
+    {
+        double t = static_cast<double>(index) / SAMPLING_FREQUENCY;
+        double beat = std::fmod(t, 0.5);                // 120 BPM
+        double off_beat = std::fmod(t + 0.25, 0.5);
+        double kick = 0.6 * std::exp(-beat / 0.06) * std::sin(2 * PI * (50 + 60 * std::exp(-beat / 0.02)) * beat);
+        double hat = 0.15 * std::exp(-off_beat / 0.015) * noise(index);
+        double pad = 0.04 * std::sin(2 * PI * 440 * t);
+        return static_cast<float>(kick + hat + pad);
+    }
+
+    bool load_wav(const std::string &path, std::vector<float> &samples)
+    {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (f == nullptr)
+            return false;
+        std::vector<uint8_t> file;
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            file.insert(file.end(), buf, buf + n);
+        fclose(f);
+        if (file.size() < 12 || memcmp(file.data(), "RIFF", 4) != 0 || memcmp(file.data() + 8, "WAVE", 4) != 0)
+            return false;
+
+        auto u16 = [&](size_t at) { return static_cast<uint16_t>(file[at] | file[at + 1] << 8); };
+        auto u32 = [&](size_t at) { return static_cast<uint32_t>(u16(at) | u16(at + 2) << 16); };
+        uint16_t channels = 0, bits = 0;
+        uint32_t rate = 0;
+        for (size_t at = 12; at + 8 <= file.size();)
+        {
+            uint32_t size = u32(at + 4);
+            size_t body = at + 8;
+            if (memcmp(&file[at], "fmt ", 4) == 0 && size >= 16 && body + 16 <= file.size())
+            {
+                channels = u16(body + 2);
+                rate = u32(body + 4);
+                bits = u16(body + 14);
+            }
+            else if (memcmp(&file[at], "data", 4) == 0 && bits == 16 && channels > 0 && rate > 0)
+            {
+                size_t frames = std::min<size_t>(size, file.size() - body) / (2 * channels);
+                // Linear resampling to SAMPLING_FREQUENCY, first channel only
+                size_t out = frames * SAMPLING_FREQUENCY / rate;
+                samples.resize(out);
+                for (size_t i = 0; i < out; i++)
+                {
+                    double pos = static_cast<double>(i) * rate / SAMPLING_FREQUENCY;
+                    size_t a = static_cast<size_t>(pos);
+                    size_t b = std::min(a + 1, frames - 1);
+                    double frac = pos - a;
+                    auto sample = [&](size_t frame) { return static_cast<int16_t>(u16(body + frame * 2 * channels)) / 32768.0; };
+                    samples[i] = static_cast<float>(sample(a) * (1 - frac) + sample(b) * frac);
+                }
+                return !samples.empty();
+            }
+            at = body + size + (size & 1);
+        }
+        return false;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    replay::Args args(argc, argv);
+    replay::Checks checks(args);
+    replay::set_log_level(args);
+
+    // Microphone input as full-scale 32-bit I2S samples
+    std::vector<float> wav;
+    std::string input = "synthetic 120 BPM";
+    if (args.has("wav"))
+    {
+        input = args.get("wav");
+        if (!load_wav(input, wav))
+        {
+            fprintf(stderr, "cannot read %s (16-bit PCM WAV expected)\n", input.c_str());
+            return 2;
+        }
+        host::set_i2s_source([&wav](uint64_t index)
+                             { return static_cast<int32_t>(wav[index % wav.size()] * 2147483647.0f); });
+    }
+    else if (args.has("tone"))
+    {
+        double hz = args.get_float("tone", 1000);
+        input = std::to_string(static_cast<int>(hz)) + "Hz tone";
+        host::set_i2s_source([hz](uint64_t index)
+                             { return static_cast<int32_t>(0.3 * std::sin(2 * PI * hz * index / SAMPLING_FREQUENCY) * 2147483647.0); });
+    }
+    else
+    {
+        host::set_i2s_source([](uint64_t index) { return static_cast<int32_t>(synthetic_beat(index) * 2147483647.0f); });
+    }
+
+    std::string mode = args.get("mode", "streaming");
+    std::string protocol = args.get("protocol", "native");
+    if ((mode != "streaming" && mode != "blocking") || (protocol != "native" && protocol != "wled" && protocol != "legacy"))
+    {
+        fprintf(stderr, "unknown --mode or --protocol, see the top of replay_audio.cpp\n");
+        return 2;
+    }
+
+    FastconController controller;
+    App.register_component(&controller);
+    auto *effect = new MusicReactiveEffectUDP(true);
+    App.register_component(effect);
+    effect->set_controller(&controller);
+    effect->set_color_mode("Spectrum");
+    long fixtures = args.get_int("fixtures", 6);
+    for (long i = 0; i < fixtures; i++)
+        effect->add_spectrum_fixture(0x1001 + i);
+    effect->set_num_bands(args.get_int("bands", 16));
+    effect->set_streaming_capture(mode == "streaming", args.get_float("overlap", 0.5));
+    effect->set_sync_protocol(protocol == "wled" ? SYNC_WLED : protocol == "legacy" ? SYNC_LEGACY : SYNC_NATIVE);
+
+    // Everything the master sends, decoded enough to check the analysis
+    FILE *record = nullptr;
+    if (args.has("record-packets"))
+    {
+        record = fopen(args.get("record-packets").c_str(), "w");
+        if (record == nullptr)
+        {
+            fprintf(stderr, "cannot write %s\n", args.get("record-packets").c_str());
+            return 2;
+        }
+        fprintf(record, "# replay_audio %s, %s capture, %s protocol: send time (ms) and datagram (hex)\n",
+                input.c_str(), mode.c_str(), protocol.c_str());
+    }
+    uint32_t packets = 0, packets_after_warmup = 0;
+    std::vector<uint32_t> peaks;                // WLED FFT_MajorPeak after the warm-up
+    peaks.reserve(1024);
+    host::set_udp_sink([&](uint32_t at, const IPAddress &, const uint8_t *data, size_t len)
+                       {
+        packets++;
+        if (at >= WARMUP_MS)
+        {
+            packets_after_warmup++;
+            if (protocol == "wled" && len >= WLED_PACKET_SIZE && peaks.size() < peaks.capacity())
+            {
+                float hz;
+                memcpy(&hz, data + 40, sizeof(hz));
+                peaks.push_back(static_cast<uint32_t>(hz + 0.5f));
+            }
+        }
+        if (record != nullptr)
+        {
+            fprintf(record, "%u ", at);
+            for (size_t i = 0; i < len; i++)
+                fprintf(record, "%02x", data[i]);
+            fputc('\n', record);
+        } });
+    uint32_t effect_adverts = 0;
+    controller.set_on_air_callback([&](const FastconController::Advert &advert)
+                                   {
+        if (advert.raw)
+            effect_adverts++; });
+
+    App.setup();
+    effect->start();
+
+    long seconds = std::max(args.get_int("seconds", 25), 21L);
+    replay::WallTimer wall;
+    replay::run_for(WARMUP_MS);
+    host::AllocStats before = host::alloc_stats();
+    replay::run_for(seconds * 1000 - WARMUP_MS);
+    host::AllocStats after = host::alloc_stats();
+    double wall_ms = wall.elapsed_ms();
+    if (record != nullptr)
+        fclose(record);
+    uint64_t allocations = after.allocations - before.allocations;
+
+    // Stage statistics are those of the last complete 10s profiling window
+    printf("replay_audio: %s, %s capture, %s protocol, %ld fixtures, %lds\n", input.c_str(), mode.c_str(),
+           protocol.c_str(), fixtures, seconds);
+    auto stage = [](const char *name, const StageStats &stats)
+    { printf("  %-8s %6u %6u %6u %7u\n", name, stats.min_us, stats.avg_us, stats.max_us, stats.count); };
+    printf("  stage    min_us avg_us max_us   count (last %ds window)\n", PROFILE_WINDOW_MS / 1000);
+    stage("capture", effect->get_capture_stats());
+    stage("fft", effect->get_fft_stats());
+    stage("mapping", effect->get_mapping_stats());
+    stage("send", effect->get_send_stats());
+    stage("frame", effect->get_frame_stats());
+    float analyses = effect->get_fft_stats().count * 1000.0f / PROFILE_WINDOW_MS;
+    printf("analyses %.1f/s, packets %u (%.1f/s), frame overruns %lu\n", analyses, packets,
+           effect->get_packet_rate(), effect->get_frame_overruns());
+    printf("tempo %.1f BPM, %u beats\n", effect->get_bpm(), effect->get_beat_count());
+    printf("effect adverts on air %u, effect frames superseded %u, controller drops %u\n", effect_adverts,
+           FastconScheduler::find(&controller)->get_effects_superseded(), controller.get_adverts_dropped());
+    printf("i2s samples read %llu, lost %llu\n", (unsigned long long)host::i2s_samples_read(),
+           (unsigned long long)host::i2s_samples_lost());
+    printf("heap allocations after warm-up %llu (%.2f per packet, %llu bytes)\n", (unsigned long long)allocations,
+           packets_after_warmup ? static_cast<double>(allocations) / packets_after_warmup : 0.0,
+           (unsigned long long)(after.bytes - before.bytes));
+    if (!peaks.empty())
+        printf("FFT major peak median %uHz\n", replay::percentile(peaks, 0.5));
+    printf("host: %lds of audio in %.1fms (%.0fx real time)\n", seconds, wall_ms,
+           wall_ms > 0 ? seconds * 1000.0 / wall_ms : 0.0);
+
+    if (args.has("expect-bpm"))
+    {
+        double expected = args.get_float("expect-bpm", 0);
+        double tolerance = args.get_float("bpm-tolerance", 3);
+        if (std::fabs(effect->get_bpm() - expected) > tolerance)
+            checks.fail("tempo is %.1f BPM, expected %.1f +-%.1f", effect->get_bpm(), expected, tolerance);
+    }
+    if (args.has("expect-peak-hz"))
+    {
+        double expected = args.get_float("expect-peak-hz", 0);
+        double tolerance = args.get_float("peak-tolerance", 0.25);
+        double peak = replay::percentile(peaks, 0.5);
+        if (std::fabs(peak - expected) > expected * tolerance)
+            checks.fail("FFT major peak is %.0fHz, expected %.0fHz +-%.0f%%", peak, expected, tolerance * 100);
+    }
+    checks.at_most("max-allocs", "heap allocations after warm-up", allocations);
+    checks.at_most("max-lost-samples", "i2s samples lost", host::i2s_samples_lost());
+    checks.at_least("min-analyses", "analyses per second", analyses);
+    return checks.exit_code();
+}
@@ -0,0 +1,397 @@
+// Replays a recorded Home Assistant state stream into FastconLight + FastconScheduler on
+// the fake controller, and measures what reaches the air.
+//
+//   replay_light <stream.csv> [--passes 2] [--adv-duration 50] [--adv-gap 10] [--queue 100]
+//                [--broadcast ADDR] [--group ADDR:ID,ID,...] [--burst MS] [--apply-cost MS] [--rekey]
+//                [--verbose]
+//                [--max-adverts N] [--max-p95-ms N] [--max-allocs N]
+//
+// Stream format, one HA light call per line ('#' starts a comment):
+//   time_ms,light_id,on|off,brightness,red,green,blue,transition_ms
+// brightness and colors are 0-255; leave the colors empty for a white light. Lines with the
+// same time are one scene. The stream is played `passes` times back to back; the first pass
+// warms the caches, the last one is what the checks look at. --apply-cost advances the clock
+// between a transformer's apply() and is_finished(), like a slow loop on the device. --rekey
+// changes the mesh key on the controller itself before the last pass, so the lights can only
+// follow adverts built with the new key. The adverts' sequence numbers must always move forward.
+
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include "esphome/core/application.h"
+#include "fastcon_controller.h"
+#include "fastcon_light_optimized.h"
+#include "fastcon_scheduler.h"
+#include "host.h"
+#include "replay.h"
+
+using namespace esphome;
+using namespace esphome::fastcon;
+
+namespace
+{
+    struct Event
+    {
+        uint32_t at;
+        uint8_t light_id;
+        bool on;
+        uint8_t brightness;
+        bool rgb;
+        uint8_t red, green, blue;
+        uint32_t transition;
+    };
+
+    // HA's side of one light: its LightState and the transition ESPHome would be running
+    struct HaLight
+    {
+        FastconLight *output{nullptr};
+        light::LightState state;
+        std::unique_ptr<light::LightTransformer> transformer;
+        LightData expected;                     // Light data of the newest call's final state
+        uint32_t settled_at{0};                 // When that state was final (call + transition)
+        bool awaiting{false};                   // expected hasn't been on air since
+        LightData aired;                        // Last light data on air for this light
+    };
+
+    struct PassStats
+    {
+        uint32_t calls{0};
+        uint32_t adverts{0};
+        uint32_t broadcasts{0};
+        uint32_t groups{0};
+        uint32_t dedup_hits{0};
+        host::AllocStats allocs{};
+        std::vector<uint32_t> latencies;        // Call (or end of its transition) to on air
+    };
+
+    struct Group
+    {
+        uint32_t address;
+        std::vector<uint8_t> members;
+    };
+
+    bool parse_event(const std::string &line, Event &event)
+    {
+        char fields[8][16] = {{0}};
+        // Split on commas by hand, sscanf can't express empty fields
+        size_t field = 0, pos = 0;
+        for (char c : line)
+        {
+            if (c == ',')
+            {
+                fields[field][pos] = 0;
+                if (++field == 8)
+                    return false;
+                pos = 0;
+            }
+            else if (pos < sizeof(fields[0]) - 1 && c != ' ')
+            {
+                fields[field][pos++] = c;
+            }
+        }
+        if (field < 3)
+            return false;
+        event.at = std::strtoul(fields[0], nullptr, 10);
+        event.light_id = std::strtoul(fields[1], nullptr, 10);
+        event.on = strcmp(fields[2], "on") == 0;
+        event.brightness = fields[3][0] ? std::strtoul(fields[3], nullptr, 10) : 255;
+        event.rgb = fields[4][0] && fields[5][0] && fields[6][0];
+        event.red = std::strtoul(fields[4], nullptr, 10);
+        event.green = std::strtoul(fields[5], nullptr, 10);
+        event.blue = std::strtoul(fields[6], nullptr, 10);
+        event.transition = std::strtoul(fields[7], nullptr, 10);
+        return true;
+    }
+
+    light::LightColorValues target_values(const light::LightColorValues &current, const Event &event)
+    {
+        light::LightColorValues values = current;
+        values.set_state(event.on ? 1.0f : 0.0f);
+        if (!event.on)
+            return values;
+        values.set_brightness(event.brightness / 255.0f);
+        values.set_color_mode(event.rgb ? light::ColorMode::RGB : light::ColorMode::BRIGHTNESS);
+        if (event.rgb)
+        {
+            values.set_red(event.red / 255.0f);
+            values.set_green(event.green / 255.0f);
+            values.set_blue(event.blue / 255.0f);
+        }
+        return values;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    replay::Args args(argc, argv);
+    replay::Checks checks(args);
+    replay::set_log_level(args);
+    if (args.positional().empty())
+    {
+        fprintf(stderr, "usage: replay_light <stream.csv> [options], see the top of replay_light.cpp\n");
+        return 2;
+    }
+
+    std::string path = args.positional()[0];
+    std::vector<std::string> lines;
+    if (!replay::read_lines(path, lines))
+    {
+        fprintf(stderr, "cannot read %s\n", path.c_str());
+        return 2;
+    }
+    std::vector<Event> events;
+    for (const auto &line : lines)
+    {
+        if (!isdigit(static_cast<unsigned char>(line[0])))
+            continue;                           // Column header
+        Event event;
+        if (!parse_event(line, event))
+        {
+            fprintf(stderr, "bad line in %s: %s\n", path.c_str(), line.c_str());
+            return 2;
+        }
+        events.push_back(event);
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.at < b.at; });
+    if (events.empty())
+    {
+        fprintf(stderr, "%s has no events\n", path.c_str());
+        return 2;
+    }
+
+    // Same wiring as the generated code: controller, then the lights bound to it
+    FastconController controller;
+    controller.set_adv_duration(args.get_int("adv-duration", 50));
+    controller.set_adv_gap(args.get_int("adv-gap", 10));
+    controller.set_max_queue_size(args.get_int("queue", 100));
+    App.register_component(&controller);
+
+    std::array<int, 256> index;
+    index.fill(-1);
+    std::vector<HaLight> lights;
+    lights.reserve(256);
+    for (const auto &event : events)
+    {
+        if (index[event.light_id] >= 0)
+            continue;
+        index[event.light_id] = lights.size();
+        lights.emplace_back();
+        lights.back().output = new FastconLight(event.light_id);
+        App.register_component(lights.back().output);
+        lights.back().output->set_controller(&controller);
+    }
+    FastconScheduler *scheduler = FastconScheduler::find(&controller);
+
+    bool has_broadcast = args.has("broadcast");
+    uint32_t broadcast = args.get_int("broadcast", 0);
+    if (has_broadcast)
+        scheduler->set_broadcast_address(broadcast);
+    std::vector<Group> groups;
+    for (const auto &spec : args.get_all("group"))
+    {
+        Group group;
+        group.address = std::strtoul(spec.c_str(), nullptr, 0);
+        size_t colon = spec.find(':');
+        for (size_t pos = colon; pos != std::string::npos; pos = spec.find(',', pos + 1))
+            group.members.push_back(std::strtoul(spec.c_str() + pos + 1, nullptr, 10));
+        scheduler->add_group(group.address, group.members);
+        groups.push_back(group);
+    }
+    scheduler->set_burst_adv_duration(args.get_int("burst", 0));
+
+    long passes = std::max(args.get_int("passes", 2), 1L);
+    uint32_t apply_cost = args.get_int("apply-cost", 0);
+    std::vector<PassStats> stats(passes);
+    for (auto &pass : stats)
+        pass.latencies.reserve(events.size());
+    PassStats *current = &stats[0];
+
+    auto on_air = [&](HaLight &light, const LightData &data, uint32_t at)
+    {
+        light.aired = data;
+        if (light.awaiting && data == light.expected)
+        {
+            // A transition can reach its final light data a little before it formally ends
+            current->latencies.push_back(at > light.settled_at ? at - light.settled_at : 0);
+            light.awaiting = false;
+        }
+    };
+    uint32_t unreadable = 0, out_of_sequence = 0;
+    bool has_sequence = false;
+    uint8_t last_sequence = 0;
+    controller.set_on_air_callback([&](const FastconController::Advert &advert)
+                                   {
+        uint32_t addr;
+        LightData data;
+        uint8_t sequence;
+        if (advert.raw)
+            return;
+        if (!controller.decode(advert.data, addr, data, sequence))
+        {
+            unreadable++;
+            return;
+        }
+        // A rejected command leaves a gap, but a replayed advert must never go back
+        if (has_sequence && static_cast<int8_t>(sequence - last_sequence) <= 0)
+            out_of_sequence++;
+        has_sequence = true;
+        last_sequence = sequence;
+        current->adverts++;
+        if (has_broadcast && addr == broadcast)
+        {
+            current->broadcasts++;
+            for (auto &light : lights)
+                on_air(light, data, advert.on_air_at);
+            return;
+        }
+        for (const auto &group : groups)
+        {
+            if (group.address != addr)
+                continue;
+            current->groups++;
+            for (uint8_t id : group.members)
+            {
+                if (index[id] >= 0)
+                    on_air(lights[index[id]], data, advert.on_air_at);
+            }
+            return;
+        }
+        if (addr < index.size() && index[addr] >= 0)
+            on_air(lights[index[addr]], data, advert.on_air_at); });
+
+    App.setup();
+
+    std::vector<uint8_t> scratch;
+    scratch.reserve(16);
+    replay::WallTimer wall;
+    uint32_t last_event = events.back().at;
+    for (long p = 0; p < passes; p++)
+    {
+        current = &stats[p];
+        if (args.has("rekey") && p == passes - 1)
+            controller.set_mesh_key({0x5a, 0x17, 0xc3, 0x08});
+        uint32_t dedup_before = scheduler->get_dedup_hits();
+        host::AllocStats allocs_before = host::alloc_stats();
+        uint32_t start = host::now_ms();
+        size_t next = 0;
+        uint32_t idle_since = 0;
+
+        // Play the calls on time, then let the pipeline drain (10s at most)
+        while (true)
+        {
+            uint32_t elapsed = host::now_ms() - start;
+            while (next < events.size() && events[next].at <= elapsed)
+            {
+                const Event &event = events[next++];
+                HaLight &light = lights[index[event.light_id]];
+                light::LightColorValues target = target_values(light.state.current_values, event);
+                light::LightState final_state;
+                final_state.current_values = target;
+                controller.get_light_data(&final_state, scratch);
+                light.expected.assign(scratch);
+                light.settled_at = host::now_ms() + event.transition;
+                light.awaiting = light.expected != light.aired;
+                current->calls++;
+
+                if (event.transition > 0)
+                {
+                    light.transformer = light.output->create_default_transition();
+                    light.transformer->setup(light.state.current_values, target, event.transition);
+                }
+                else
+                {
+                    light.transformer.reset();
+                    light.state.current_values = target;
+                    light.output->write_state(&light.state);
+                }
+            }
+
+            // LightState::loop(): a running transition writes every step it produces
+            bool busy = next < events.size() || controller.get_queue_size() > 0;
+            for (auto &light : lights)
+            {
+                busy |= light.awaiting;
+                if (!light.transformer)
+                    continue;
+                busy = true;
+                auto values = light.transformer->apply();
+                if (values.has_value())
+                {
+                    light.state.current_values = *values;
+                    light.output->write_state(&light.state);
+                }
+                // A busy loop lets the clock move between apply() and is_finished()
+                host::advance_ms(apply_cost);
+                if (light.transformer->is_finished())
+                {
+                    light.transformer->stop();
+                    light.transformer.reset();
+                }
+            }
+
+            replay::tick();
+            if (busy)
+                idle_since = host::now_ms();
+            if (host::now_ms() - idle_since >= 500 || elapsed > last_event + 10000)
+                break;
+        }
+
+        host::AllocStats allocs_after = host::alloc_stats();
+        current->allocs = {allocs_after.allocations - allocs_before.allocations, allocs_after.bytes - allocs_before.bytes};
+        current->dedup_hits = scheduler->get_dedup_hits() - dedup_before;
+    }
+    double wall_ms = wall.elapsed_ms();
+
+    // Idle long enough for the scheduler to close its statistics window
+    replay::run_for(61000);
+
+    printf("replay_light: %s, %zu lights, %ld passes (adv %u+%ums, queue %zu)\n", path.c_str(), lights.size(),
+           passes, controller.get_adv_duration(), controller.get_adv_gap(), controller.get_max_queue_size());
+    printf("pass  calls  adverts  bcast  group  dedup  p50ms  p95ms  maxms  allocs\n");
+    for (long p = 0; p < passes; p++)
+    {
+        PassStats &pass = stats[p];
+        uint32_t p50 = replay::percentile(pass.latencies, 0.5);
+        uint32_t p95 = replay::percentile(pass.latencies, 0.95);
+        uint32_t max = pass.latencies.empty() ? 0 : pass.latencies.back();
+        printf("%4ld %6u %8u %6u %6u %6u %6u %6u %6u %7llu\n", p + 1, pass.calls, pass.adverts, pass.broadcasts,
+               pass.groups, pass.dedup_hits, p50, p95, max, (unsigned long long)pass.allocs.allocations);
+    }
+    const PipelineStats &window = scheduler->get_stats();
+    printf("scheduler window: time to air p95 <=%ums max %ums, debounce p95 <=%ums, queue wait p95 <=%ums, depth max %zu\n",
+           window.time_to_air.percentile(0.95f), window.time_to_air.max(), window.debounce_wait.percentile(0.95f),
+           window.queue_wait.percentile(0.95f), scheduler->get_queue_depth_max());
+    printf("command cache %u hits / %u misses, controller drops %u (scheduler counted %u)\n",
+           scheduler->get_cache_hits(), scheduler->get_cache_misses(), controller.get_adverts_dropped(),
+           scheduler->get_commands_dropped());
+    printf("adverts unreadable %u, out of sequence %u\n", unreadable, out_of_sequence);
+    uint32_t total_calls = 0;
+    for (const auto &pass : stats)
+        total_calls += pass.calls;
+    printf("host: %u calls in %.1fms (%.0f calls/s)\n", total_calls, wall_ms,
+           wall_ms > 0 ? total_calls * 1000.0 / wall_ms : 0.0);
+
+    // Every light must end up showing the state of its last call
+    for (size_t i = 0; i < index.size(); i++)
+    {
+        if (index[i] < 0)
+            continue;
+        const HaLight &light = lights[index[i]];
+        if (light.aired != light.expected)
+            checks.fail("light %zu never got its final state on air", i);
+    }
+    if (scheduler->get_commands_dropped() != controller.get_adverts_dropped())
+        checks.fail("scheduler counted %u dropped commands, the controller dropped %u",
+                    scheduler->get_commands_dropped(), controller.get_adverts_dropped());
+    if (unreadable > 0)
+        checks.fail("%u adverts were built with a stale mesh key", unreadable);
+    if (out_of_sequence > 0)
+        checks.fail("%u adverts went out with an old sequence number", out_of_sequence);
+    PassStats &last = stats.back();
+    checks.at_most("max-adverts", "adverts on air (last pass)", last.adverts);
+    checks.at_most("max-p95-ms", "p95 call-to-air latency (last pass)", replay::percentile(last.latencies, 0.95));
+    checks.at_most("max-allocs", "heap allocations (last pass)", last.allocs.allocations);
+    checks.at_most("max-drops", "adverts dropped by the controller", controller.get_adverts_dropped());
+    return checks.exit_code();
+}
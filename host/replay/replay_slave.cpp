@@ -0,0 +1,177 @@
+// Replays captured sync packets into a music_reactive slave: reception, sequencing,
+// jitter and clock offset tracking, playout and the per-light mapping into the
+// scheduler's effect lane on the fake controller.
+//
+//   replay_slave <packets.txt> [--latency 5] [--jitter MS] [--loss PCT] [--seed 1]
+//                [--playout-delay 60] [--fixtures 6] [--verbose]
+//                [--max-allocs N] [--min-accepted-percent N] [--max-late N]
+//
+// The capture is what replay_audio --record-packets writes: one datagram per line, the
+// master's send time in ms and the bytes in hex. Every packet is delivered after
+// latency + a random 0..jitter ms (so a jitter above the frame interval reorders them),
+// or dropped with probability loss%. The slave's clock starts 1s away from the master's.
+
+#include <cstring>
+#include "esphome/core/application.h"
+#include "fastcon_controller.h"
+#include "fastcon_scheduler.h"
+#include "host.h"
+#include "music_reactive.h"
+#include "replay.h"
+
+using namespace esphome;
+using namespace esphome::fastcon;
+
+namespace
+{
+    constexpr uint32_t CLOCK_DIFFERENCE_MS = 1000;
+    constexpr uint32_t WARMUP_MS = 2000;
+
+    struct Packet
+    {
+        uint32_t sent_at;
+        std::vector<uint8_t> data;
+    };
+
+    bool parse_packet(const std::string &line, Packet &packet)
+    {
+        char *hex;
+        packet.sent_at = std::strtoul(line.c_str(), &hex, 10);
+        while (*hex == ' ')
+            hex++;
+        size_t len = strlen(hex);
+        if (len == 0 || len % 2 != 0 || len / 2 > UDP_MAX_PACKET_SIZE)
+            return false;
+        for (size_t i = 0; i < len; i += 2)
+        {
+            char byte[3] = {hex[i], hex[i + 1], 0};
+            char *end;
+            packet.data.push_back(std::strtoul(byte, &end, 16));
+            if (*end != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Small deterministic generator, so a seed reproduces the same network
+    struct Random
+    {
+        uint64_t state;
+        uint32_t next()
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return static_cast<uint32_t>(state >> 33);
+        }
+        double uniform() { return next() / 2147483648.0; }
+    };
+} // namespace
+
+int main(int argc, char **argv)
+{
+    replay::Args args(argc, argv);
+    replay::Checks checks(args);
+    replay::set_log_level(args);
+    if (args.positional().empty())
+    {
+        fprintf(stderr, "usage: replay_slave <packets.txt> [options], see the top of replay_slave.cpp\n");
+        return 2;
+    }
+
+    std::string path = args.positional()[0];
+    std::vector<std::string> lines;
+    if (!replay::read_lines(path, lines))
+    {
+        fprintf(stderr, "cannot read %s\n", path.c_str());
+        return 2;
+    }
+    std::vector<Packet> packets;
+    for (const auto &line : lines)
+    {
+        Packet packet;
+        if (!parse_packet(line, packet))
+        {
+            fprintf(stderr, "bad line in %s: %s\n", path.c_str(), line.c_str());
+            return 2;
+        }
+        packets.push_back(std::move(packet));
+    }
+    if (packets.empty())
+    {
+        fprintf(stderr, "%s has no packets\n", path.c_str());
+        return 2;
+    }
+
+    FastconController controller;
+    App.register_component(&controller);
+    auto *effect = new MusicReactiveEffectUDP(false);
+    App.register_component(effect);
+    effect->set_controller(&controller);
+    effect->set_color_mode("Spectrum");
+    long fixtures = args.get_int("fixtures", 6);
+    for (long i = 0; i < fixtures; i++)
+        effect->add_spectrum_fixture(0x1001 + i);
+    effect->set_playout_delay(args.get_int("playout-delay", 60));
+    uint32_t effect_adverts = 0;
+    controller.set_on_air_callback([&](const FastconController::Advert &advert)
+                                   {
+        if (advert.raw)
+            effect_adverts++; });
+
+    // The network: fixed latency plus jitter, random loss
+    uint32_t latency = args.get_int("latency", 5);
+    uint32_t jitter = args.get_int("jitter", 0);
+    double loss = args.get_float("loss", 0) / 100.0;
+    Random random{static_cast<uint64_t>(args.get_int("seed", 1))};
+    IPAddress master(192, 168, 1, 60);
+    uint32_t delivered = 0, last_delivery = 0;
+    for (const auto &packet : packets)
+    {
+        if (random.uniform() < loss)
+            continue;
+        uint32_t at = packet.sent_at + CLOCK_DIFFERENCE_MS + latency + (jitter ? random.next() % (jitter + 1) : 0);
+        host::inject_datagram(at, master, packet.data.data(), packet.data.size());
+        delivered++;
+        last_delivery = std::max(last_delivery, at);
+    }
+
+    App.setup();
+    effect->start();
+
+    // Stop shortly after the last packet; the slave warns once the master has been silent 5s
+    replay::WallTimer wall;
+    replay::run_for(WARMUP_MS + CLOCK_DIFFERENCE_MS);
+    host::AllocStats before = host::alloc_stats();
+    uint32_t accepted_before = effect->get_packet_count();
+    replay::run_for(last_delivery + 1000 - host::now_ms());
+    host::AllocStats after = host::alloc_stats();
+    double wall_ms = wall.elapsed_ms();
+    uint64_t allocations = after.allocations - before.allocations;
+    uint32_t accepted = effect->get_packet_count();
+    double accepted_percent = 100.0 * accepted / packets.size();
+
+    printf("replay_slave: %s, %zu packets, latency %ums, jitter %ums, loss %.1f%%\n", path.c_str(), packets.size(),
+           latency, jitter, loss * 100);
+    printf("delivered %u, accepted %u (%.1f%%), lost %lu, reordered %lu, discarded %lu\n", delivered, accepted,
+           accepted_percent, effect->get_packets_lost(), effect->get_packets_reordered(),
+           effect->get_packets_discarded());
+    printf("jitter %.1fms, clock offset %dms, frames late %lu\n", effect->get_jitter_ms(), effect->get_clock_offset(),
+           effect->get_frames_late());
+    auto stage = [](const char *name, const StageStats &stats)
+    { printf("  %-8s %6u %6u %6u %7u\n", name, stats.min_us, stats.avg_us, stats.max_us, stats.count); };
+    printf("  stage    min_us avg_us max_us   count (last %ds window)\n", PROFILE_WINDOW_MS / 1000);
+    stage("receive", effect->get_receive_stats());
+    stage("mapping", effect->get_mapping_stats());
+    stage("frame", effect->get_frame_stats());
+    printf("effect adverts on air %u, effect frames superseded %u\n", effect_adverts,
+           FastconScheduler::find(&controller)->get_effects_superseded());
+    uint32_t counted = accepted - accepted_before;
+    printf("heap allocations after warm-up %llu (%.2f per packet)\n", (unsigned long long)allocations,
+           counted ? static_cast<double>(allocations) / counted : 0.0);
+    printf("host: %zu packets in %.1fms (%.0f packets/s)\n", packets.size(), wall_ms,
+           wall_ms > 0 ? packets.size() * 1000.0 / wall_ms : 0.0);
+
+    checks.at_most("max-allocs", "heap allocations after warm-up", allocations);
+    checks.at_least("min-accepted-percent", "accepted packets (%)", accepted_percent);
+    checks.at_most("max-late", "frames late", effect->get_frames_late());
+    return checks.exit_code();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "esphome/core/hal.h"
+
+// Same as the ESP32 Arduino core
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Arduino String on std::string, with the constructors and operators the components use
+class String
+{
+public:
+    String() = default;
+    String(const char *s) : s_(s == nullptr ? "" : s) {}
+    String(const std::string &s) : s_(s) {}
+    String(int value) : s_(std::to_string(value)) {}
+    String(unsigned int value) : s_(std::to_string(value)) {}
+    String(long value) : s_(std::to_string(value)) {}
+    String(unsigned long value) : s_(std::to_string(value)) {}
+    String(float value, unsigned char decimal_places = 2) : s_(format_(value, decimal_places)) {}
+    String(double value, unsigned char decimal_places = 2) : s_(format_(value, decimal_places)) {}
+
+    const char *c_str() const { return s_.c_str(); }
+    size_t length() const { return s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+
+    bool operator==(const String &other) const { return s_ == other.s_; }
+    bool operator==(const char *other) const { return s_ == other; }
+    bool operator!=(const String &other) const { return s_ != other.s_; }
+    bool operator!=(const char *other) const { return s_ != other; }
+    String operator+(const String &other) const { return String(s_ + other.s_); }
+    String &operator+=(const String &other)
+    {
+        s_ += other.s_;
+        return *this;
+    }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.s_); }
+
+private:
+    static std::string format_(double value, unsigned char decimal_places)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", decimal_places, value);
+        return buf;
+    }
+
+    std::string s_;
+};
+
+// FreeRTOS, as far as the audio core uses it. The host build is single threaded: replays
+// keep the capture task off, and blocking waits advance the virtual clock instead.
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void *), const char *name, uint32_t stack, void *arg,
+                                   int priority, TaskHandle_t *handle, BaseType_t core);
+BaseType_t xPortGetCoreID();
+void vTaskDelay(TickType_t ticks);
+
+#include "IPAddress.h"
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class String;
+
+class IPAddress
+{
+public:
+    IPAddress() = default;
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes_{a, b, c, d} {}
+
+    uint8_t operator[](int i) const { return bytes_[i]; }
+    uint8_t &operator[](int i) { return bytes_[i]; }
+    bool operator==(const IPAddress &other) const { return memcmp(bytes_, other.bytes_, 4) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+
+    bool fromString(const char *s)
+    {
+        unsigned a, b, c, d;
+        char tail;
+        if (s == nullptr || sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 ||
+            c > 255 || d > 255)
+            return false;
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    String toString() const;
+
+private:
+    uint8_t bytes_[4]{};
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+// Always connected as 192.168.1.50/24 unless a replay says otherwise (host::set_wifi_connected)
+class WiFiClass
+{
+public:
+    int status();
+    IPAddress localIP() { return IPAddress(192, 168, 1, 50); }
+    IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "WiFi.h"
+
+// Every socket shares the replay's network (see host.h): sent datagrams go to its sink,
+// parsePacket() returns the next injected datagram whose delivery time has come.
+class WiFiUDP
+{
+public:
+    uint8_t begin(uint16_t port);
+    uint8_t beginMulticast(IPAddress group, uint16_t port);
+    void stop() {}
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(const uint8_t *data, size_t len);
+    int endPacket();
+
+    int parsePacket();
+    int available() { return static_cast<int>(rx_len_ - rx_pos_); }
+    int read(uint8_t *buf, size_t len);
+    int read(char *buf, size_t len) { return read(reinterpret_cast<uint8_t *>(buf), len); }
+    IPAddress remoteIP() const { return rx_from_; }
+    void flush() {}
+
+private:
+    uint8_t tx_[1472];
+    size_t tx_len_{0};
+    IPAddress tx_to_;
+    uint8_t rx_[1472];
+    size_t rx_len_{0};
+    size_t rx_pos_{0};
+    IPAddress rx_from_;
+};
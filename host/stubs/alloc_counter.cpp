@@ -0,0 +1,44 @@
+#include <cstdlib>
+#include <new>
+#include "host.h"
+
+// Every heap allocation in a replay binary goes through here, so drivers can report how
+// many the components make per command or per frame once they are warmed up
+namespace
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    void *counted_alloc(size_t size)
+    {
+        allocations++;
+        bytes += size;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+} // namespace
+
+void *operator new(size_t size)
+{
+    if (void *p = counted_alloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    if (void *p = counted_alloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace host
+{
+    AllocStats alloc_stats() { return {allocations, bytes}; }
+} // namespace host
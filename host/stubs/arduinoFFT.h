@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// arduinoFFT 1.x API, implemented the same way (double precision, in-place radix-2 with a
+// bit-reversal pass first), so host timings and magnitudes track the firmware's backend
+#define FFT_FORWARD 0x01
+#define FFT_REVERSE 0x00
+#define FFT_WIN_TYP_RECTANGLE 0x00
+#define FFT_WIN_TYP_HAMMING 0x01
+
+class arduinoFFT
+{
+public:
+    void Windowing(double *vData, uint16_t samples, uint8_t windowType, uint8_t dir)
+    {
+        if (windowType != FFT_WIN_TYP_HAMMING)
+            return;
+        for (uint16_t i = 0; i < samples / 2; i++)
+        {
+            double factor = 0.54 - 0.46 * cos(2.0 * M_PI * i / (samples - 1));
+            if (dir == FFT_FORWARD)
+            {
+                vData[i] *= factor;
+                vData[samples - 1 - i] *= factor;
+            }
+            else
+            {
+                vData[i] /= factor;
+                vData[samples - 1 - i] /= factor;
+            }
+        }
+    }
+
+    void Compute(double *vReal, double *vImag, uint16_t samples, uint8_t dir)
+    {
+        // Bit reversal
+        uint16_t j = 0;
+        for (uint16_t i = 0; i < samples - 1; i++)
+        {
+            if (i < j)
+            {
+                swap(vReal[i], vReal[j]);
+                swap(vImag[i], vImag[j]);
+            }
+            uint16_t k = samples >> 1;
+            while (k <= j)
+            {
+                j -= k;
+                k >>= 1;
+            }
+            j += k;
+        }
+
+        // Butterflies
+        double c1 = -1.0;
+        double c2 = 0.0;
+        uint16_t l2 = 1;
+        for (uint16_t l = 1; l < samples; l <<= 1)
+        {
+            uint16_t l1 = l2;
+            l2 <<= 1;
+            double u1 = 1.0;
+            double u2 = 0.0;
+            for (uint16_t m = 0; m < l1; m++)
+            {
+                for (uint16_t i = m; i < samples; i += l2)
+                {
+                    uint16_t i1 = i + l1;
+                    double t1 = u1 * vReal[i1] - u2 * vImag[i1];
+                    double t2 = u1 * vImag[i1] + u2 * vReal[i1];
+                    vReal[i1] = vReal[i] - t1;
+                    vImag[i1] = vImag[i] - t2;
+                    vReal[i] += t1;
+                    vImag[i] += t2;
+                }
+                double z = u1 * c1 - u2 * c2;
+                u2 = u1 * c2 + u2 * c1;
+                u1 = z;
+            }
+            c2 = sqrt((1.0 - c1) / 2.0);
+            c1 = sqrt((1.0 + c1) / 2.0);
+            if (dir == FFT_FORWARD)
+                c2 = -c2;
+        }
+    }
+
+    void ComplexToMagnitude(double *vReal, double *vImag, uint16_t samples)
+    {
+        for (uint16_t i = 0; i < samples; i++)
+            vReal[i] = sqrt(vReal[i] * vReal[i] + vImag[i] * vImag[i]);
+    }
+
+    double MajorPeak(double *vD, uint16_t samples, double samplingFrequency)
+    {
+        double maxY = 0;
+        uint16_t IndexOfMaxY = 0;
+        for (uint16_t i = 1; i < (samples >> 1); i++)
+        {
+            if (vD[i - 1] < vD[i] && vD[i] > vD[i + 1] && vD[i] > maxY)
+            {
+                maxY = vD[i];
+                IndexOfMaxY = i;
+            }
+        }
+        if (IndexOfMaxY == 0)
+            return 0.0;
+        double delta = 0.5 * ((vD[IndexOfMaxY - 1] - vD[IndexOfMaxY + 1]) /
+                              (vD[IndexOfMaxY - 1] - (2.0 * vD[IndexOfMaxY]) + vD[IndexOfMaxY + 1]));
+        return ((IndexOfMaxY + delta) * samplingFrequency) / (samples - 1);
+    }
+
+private:
+    static void swap(double &a, double &b)
+    {
+        double t = a;
+        a = b;
+        b = t;
+    }
+};
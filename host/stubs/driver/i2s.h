@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Arduino.h"
+
+// Legacy ESP-IDF I2S driver API. On the host the "microphone" is the replay's sample source
+// (host::set_i2s_source); samples become readable in whole DMA buffers, at the configured
+// sample rate of the virtual clock, and are lost once more than all DMA buffers are waiting.
+typedef int esp_err_t;
+typedef int i2s_port_t;
+typedef int i2s_mode_t;
+typedef int i2s_bits_per_sample_t;
+typedef int i2s_channel_fmt_t;
+typedef int i2s_comm_format_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define I2S_NUM_0 0
+#define I2S_NUM_1 1
+#define I2S_MODE_MASTER 1
+#define I2S_MODE_RX 4
+#define I2S_BITS_PER_SAMPLE_32BIT 32
+#define I2S_CHANNEL_FMT_ONLY_LEFT 3
+#define I2S_COMM_FORMAT_I2S 1
+#define ESP_INTR_FLAG_LEVEL1 2
+
+typedef struct
+{
+    i2s_mode_t mode;
+    int sample_rate;
+    i2s_bits_per_sample_t bits_per_sample;
+    i2s_channel_fmt_t channel_format;
+    i2s_comm_format_t communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;
+    bool use_apll;
+    bool tx_desc_auto_clear;
+    int fixed_mclk;
+} i2s_config_t;
+
+typedef struct
+{
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, void *queue);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins);
+esp_err_t i2s_read(i2s_port_t port, void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// ESP-DSP's float radix-2 FFT: interleaved re/im, dsps_fft2r_fc32() leaves the result in
+// bit-reversed order and dsps_bit_rev_fc32() puts it back, as on the device. The ANSI
+// reference version of the library, not the ESP32 assembly, so absolute timings differ.
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define CONFIG_DSP_MAX_FFT_SIZE 4096
+
+namespace esp_dsp_host
+{
+    inline float *twiddles()
+    {
+        static float table[CONFIG_DSP_MAX_FFT_SIZE];
+        return table;
+    }
+    inline int &twiddle_size()
+    {
+        static int size = 0;
+        return size;
+    }
+} // namespace esp_dsp_host
+
+// Twiddle factors for FFTs of up to `table_size` points
+inline esp_err_t dsps_fft2r_init_fc32(float *fft_table_buff, int table_size)
+{
+    (void)fft_table_buff;
+    float *w = esp_dsp_host::twiddles();
+    for (int i = 0; i < table_size / 2; i++)
+    {
+        double angle = 2.0 * M_PI * i / table_size;
+        w[2 * i] = (float)cos(angle);
+        w[2 * i + 1] = (float)sin(angle);
+    }
+    esp_dsp_host::twiddle_size() = table_size;
+    return ESP_OK;
+}
+
+inline esp_err_t dsps_fft2r_fc32(float *data, int N)
+{
+    const float *w = esp_dsp_host::twiddles();
+    int stride = esp_dsp_host::twiddle_size() / N;
+    // Decimation in frequency: natural order in, bit-reversed order out
+    for (int half = N / 2; half >= 1; half /= 2)
+    {
+        int step = N / (2 * half) * stride;
+        for (int start = 0; start < N; start += 2 * half)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                int a = 2 * (start + k);
+                int b = 2 * (start + k + half);
+                float wr = w[2 * k * step];
+                float wi = -w[2 * k * step + 1];
+                float re = data[a] - data[b];
+                float im = data[a + 1] - data[b + 1];
+                data[a] += data[b];
+                data[a + 1] += data[b + 1];
+                data[b] = re * wr - im * wi;
+                data[b + 1] = re * wi + im * wr;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+inline esp_err_t dsps_bit_rev_fc32(float *data, int N)
+{
+    int j = 0;
+    for (int i = 0; i < N - 1; i++)
+    {
+        if (i < j)
+        {
+            float re = data[2 * i];
+            float im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+        int k = N >> 1;
+        while (k <= j)
+        {
+            j -= k;
+            k >>= 1;
+        }
+        j += k;
+    }
+    return ESP_OK;
+}
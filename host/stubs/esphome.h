@@ -0,0 +1,19 @@
+#pragma once
+
+// The generated esphome.h, trimmed to what the includes: headers in this repo use
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "esphome/core/application.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/components/sensor/sensor.h"
+
+using namespace esphome;
+using namespace esphome::sensor;
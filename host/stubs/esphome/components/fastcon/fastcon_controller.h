@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/components/light/light_output.h"
+#include "fastcon_payload.h"
+
+namespace esphome
+{
+    namespace fastcon
+    {
+        // Host stand-in for the fork's FastconController: the same public API, including the
+        // getters and out-parameter overloads FORK_INSTRUCTIONS adds in step 4, with the BLE
+        // radio replaced by an airtime model. One queued advert goes on air per
+        // adv_duration + adv_gap, and the replay's callback sees each one when it does.
+        //
+        // single_control() doesn't encrypt. It lays the address, light data, a mesh key
+        // stand-in and the packet sequence byte out in the advert (same 24-byte length as the
+        // real one) so a replay can decode what reached the air.
+        class FastconController : public Component
+        {
+        public:
+            struct Advert
+            {
+                uint32_t on_air_at{0};
+                uint32_t addr{0};
+                bool raw{false};                        // send_raw_command() (effect lane)
+                uint16_t duration_ms{0};                // adv_duration it was advertised with
+                AdvPayload data;
+            };
+
+            void loop() override;
+            float get_setup_priority() const override { return setup_priority::DATA; }
+
+            std::vector<uint8_t> get_light_data(light::LightState *state);
+            void get_light_data(light::LightState *state, std::vector<uint8_t> &out);
+            std::vector<uint8_t> single_control(uint32_t addr, const std::vector<uint8_t> &light_info);
+            void single_control(uint32_t addr, const std::vector<uint8_t> &light_info, std::vector<uint8_t> &out);
+            void queueCommand(uint32_t light_id, const std::vector<uint8_t> &data);
+            void send_raw_command(uint32_t addr, const std::vector<uint8_t> &data);
+            void clear_queue() { queue_count_ = 0; }
+            bool is_queue_empty() const { return queue_count_ == 0; }
+            size_t get_queue_size() const { return queue_count_; }
+
+            void set_max_queue_size(size_t size);
+            void set_mesh_key(std::array<uint8_t, 4> key) { mesh_key_ = key; }
+            std::array<uint8_t, 4> get_mesh_key() const { return mesh_key_; }
+            // Gives an advert built earlier by single_control() the next sequence number
+            void restamp_sequence(std::vector<uint8_t> &adv);
+            void set_adv_duration(uint16_t duration) { adv_duration_ = duration; }
+            void set_adv_gap(uint16_t gap) { adv_gap_ = gap; }
+            uint16_t get_adv_duration() const { return adv_duration_; }
+            uint16_t get_adv_gap() const { return adv_gap_; }
+            size_t get_max_queue_size() const { return max_queue_size_; }
+
+            // Host side
+            void set_on_air_callback(std::function<void(const Advert &)> callback) { on_air_ = std::move(callback); }
+            // What single_control() packed into an advert; false for anything it didn't build
+            // or built with another mesh key
+            bool decode(const AdvPayload &adv, uint32_t &addr, LightData &light_data, uint8_t &sequence) const;
+            uint32_t get_adverts_aired() const { return aired_; }
+            uint32_t get_adverts_dropped() const { return dropped_; }
+            uint32_t get_single_control_calls() const { return single_control_calls_; }
+
+        protected:
+            void push_(uint32_t addr, bool raw, const std::vector<uint8_t> &data);
+
+            static constexpr size_t QUEUE_CAPACITY = 256;
+            static constexpr uint8_t ADVERT_MAGIC = 0xB5;
+            static constexpr size_t ADVERT_SIZE = 24;
+            static constexpr size_t SEQUENCE_INDEX = ADVERT_SIZE - 1;
+
+            std::array<Advert, QUEUE_CAPACITY> queue_{};    // Ring, so queueing never allocates
+            size_t queue_head_{0};
+            size_t queue_count_{0};
+            size_t max_queue_size_{100};
+            uint16_t adv_duration_{50};
+            uint16_t adv_gap_{10};
+            std::array<uint8_t, 4> mesh_key_{};
+            uint8_t sequence_{0};
+            uint32_t busy_until_{0};
+            uint32_t aired_{0};
+            uint32_t dropped_{0};
+            uint32_t single_control_calls_{0};
+            std::function<void(const Advert &)> on_air_;
+        };
+    } // namespace fastcon
+} // namespace esphome
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome
+{
+    namespace light
+    {
+        enum class ColorMode : uint8_t
+        {
+            UNKNOWN,
+            ON_OFF,
+            BRIGHTNESS,
+            WHITE,
+            COLOR_TEMPERATURE,
+            COLD_WARM_WHITE,
+            RGB,
+            RGB_WHITE,
+        };
+
+        // The values ESPHome interpolates during a transition, all 0-1 (gamma-encoded)
+        class LightColorValues
+        {
+        public:
+            LightColorValues() = default;
+
+            static LightColorValues lerp(const LightColorValues &start, const LightColorValues &end, float completion)
+            {
+                LightColorValues v;
+                v.color_mode_ = end.color_mode_;
+                v.state_ = start.state_ + (end.state_ - start.state_) * completion;
+                v.brightness_ = start.brightness_ + (end.brightness_ - start.brightness_) * completion;
+                v.red_ = start.red_ + (end.red_ - start.red_) * completion;
+                v.green_ = start.green_ + (end.green_ - start.green_) * completion;
+                v.blue_ = start.blue_ + (end.blue_ - start.blue_) * completion;
+                v.cold_white_ = start.cold_white_ + (end.cold_white_ - start.cold_white_) * completion;
+                v.warm_white_ = start.warm_white_ + (end.warm_white_ - start.warm_white_) * completion;
+                return v;
+            }
+
+            bool is_on() const { return state_ != 0.0f; }
+
+            ColorMode get_color_mode() const { return color_mode_; }
+            void set_color_mode(ColorMode mode) { color_mode_ = mode; }
+            float get_state() const { return state_; }
+            void set_state(float state) { state_ = state; }
+            float get_brightness() const { return brightness_; }
+            void set_brightness(float brightness) { brightness_ = brightness; }
+            float get_red() const { return red_; }
+            void set_red(float red) { red_ = red; }
+            float get_green() const { return green_; }
+            void set_green(float green) { green_ = green; }
+            float get_blue() const { return blue_; }
+            void set_blue(float blue) { blue_ = blue; }
+            float get_cold_white() const { return cold_white_; }
+            void set_cold_white(float cold_white) { cold_white_ = cold_white; }
+            float get_warm_white() const { return warm_white_; }
+            void set_warm_white(float warm_white) { warm_white_ = warm_white; }
+
+        protected:
+            ColorMode color_mode_{ColorMode::BRIGHTNESS};
+            float state_{0.0f};
+            float brightness_{1.0f};
+            float red_{1.0f};
+            float green_{1.0f};
+            float blue_{1.0f};
+            float cold_white_{1.0f};
+            float warm_white_{1.0f};
+        };
+    } // namespace light
+} // namespace esphome
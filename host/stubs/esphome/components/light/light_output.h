@@ -0,0 +1,77 @@
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <set>
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/light/light_color_values.h"
+#include "esphome/components/light/light_state.h"
+
+namespace esphome
+{
+    namespace light
+    {
+        class LightTraits
+        {
+        public:
+            void set_supported_color_modes(std::set<ColorMode> modes) { modes_ = modes; }
+            const std::set<ColorMode> &get_supported_color_modes() const { return modes_; }
+            void set_min_mireds(float min_mireds) { min_mireds_ = min_mireds; }
+            void set_max_mireds(float max_mireds) { max_mireds_ = max_mireds; }
+
+        protected:
+            std::set<ColorMode> modes_;
+            float min_mireds_{0};
+            float max_mireds_{0};
+        };
+
+        // Interpolates from start_values_ to target_values_ over length_ ms of millis()
+        class LightTransformer
+        {
+        public:
+            virtual ~LightTransformer() = default;
+
+            void setup(const LightColorValues &start_values, const LightColorValues &target_values, uint32_t length)
+            {
+                this->start_time_ = millis();
+                this->length_ = length;
+                this->start_values_ = start_values;
+                this->target_values_ = target_values;
+                this->start();
+            }
+
+            virtual bool is_finished() { return this->get_progress_() >= 1.0f; }
+            virtual void start() {}
+            virtual optional<LightColorValues> apply() = 0;
+            virtual void stop() {}
+
+            const LightColorValues &get_target_values() const { return this->target_values_; }
+
+        protected:
+            float get_progress_()
+            {
+                uint32_t now = millis();
+                if (now < this->start_time_)
+                    return 0.0f;
+                if (now >= this->start_time_ + this->length_)
+                    return 1.0f;
+                return static_cast<float>(now - this->start_time_) / this->length_;
+            }
+
+            uint32_t start_time_{0};
+            uint32_t length_{0};
+            LightColorValues start_values_;
+            LightColorValues target_values_;
+        };
+
+        class LightOutput
+        {
+        public:
+            virtual ~LightOutput() = default;
+            virtual LightTraits get_traits() = 0;
+            virtual void write_state(LightState *state) = 0;
+            virtual std::unique_ptr<LightTransformer> create_default_transition() { return nullptr; }
+        };
+    } // namespace light
+} // namespace esphome
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "esphome/components/light/light_color_values.h"
+
+namespace esphome
+{
+    namespace light
+    {
+        // Only what a LightOutput reads from its state; the replay sets current_values
+        // and calls write_state() itself, the way LightState::loop() does on the device
+        class LightState
+        {
+        public:
+            LightColorValues current_values;
+            LightColorValues remote_values;
+
+            float get_gamma_correct() const { return gamma_correct_; }
+            void set_gamma_correct(float gamma_correct) { gamma_correct_ = gamma_correct; }
+
+        protected:
+            float gamma_correct_{2.8f};
+        };
+    } // namespace light
+} // namespace esphome
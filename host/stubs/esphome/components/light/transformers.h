@@ -0,0 +1,23 @@
+#pragma once
+
+#include "esphome/components/light/light_output.h"
+
+namespace esphome
+{
+    namespace light
+    {
+        // ESPHome's default transition: smoothstep between start and target values
+        class LightTransitionTransformer : public LightTransformer
+        {
+        public:
+            void start() override {}
+
+            optional<LightColorValues> apply() override
+            {
+                float p = this->get_progress_();
+                float smoothed = p * p * (3.0f - 2.0f * p);
+                return LightColorValues::lerp(this->start_values_, this->target_values_, smoothed);
+            }
+        };
+    } // namespace light
+} // namespace esphome
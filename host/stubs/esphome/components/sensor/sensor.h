@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome
+{
+    namespace sensor
+    {
+        // Keeps the last published value so replays can report what HA would have seen
+        class Sensor
+        {
+        public:
+            Sensor() = default;
+            explicit Sensor(const std::string &name) : name_(name) {}
+
+            void publish_state(float state)
+            {
+                this->state = state;
+                publish_count_++;
+            }
+            uint32_t get_publish_count() const { return publish_count_; }
+
+            float state{0.0f};
+
+        protected:
+            std::string name_;
+            uint32_t publish_count_{0};
+        };
+    } // namespace sensor
+} // namespace esphome
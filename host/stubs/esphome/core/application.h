@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    // Component registry and main loop. Replays register their components the way
+    // generated code does, then call setup() once and loop() per virtual millisecond.
+    class Application
+    {
+    public:
+        template <typename C> C *register_component(C *c)
+        {
+            components_.push_back(c);
+            return c;
+        }
+
+        void setup();
+        void loop();
+
+        const std::vector<Component *> &get_components() const { return components_; }
+
+    protected:
+        std::vector<Component *> components_;
+    };
+
+    extern Application App;
+} // namespace esphome
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "esphome/core/hal.h"
+
+namespace esphome
+{
+    namespace setup_priority
+    {
+        const float BUS = 1000.0f;
+        const float IO = 900.0f;
+        const float HARDWARE = 800.0f;
+        const float DATA = 600.0f;
+        const float PROCESSOR = 400.0f;
+        const float AFTER_BLUETOOTH = 300.0f;
+        const float AFTER_WIFI = 200.0f;
+        const float AFTER_CONNECTION = 100.0f;
+        const float LATE = -100.0f;
+    } // namespace setup_priority
+
+    // The part of ESPHome's Component the components in this repo use; App calls
+    // setup() in priority order and loop() on every pass, like on the device
+    class Component
+    {
+    public:
+        virtual ~Component() = default;
+
+        virtual void setup() {}
+        virtual void loop() {}
+        virtual void dump_config() {}
+        virtual float get_setup_priority() const { return setup_priority::DATA; }
+
+        void mark_failed() { failed_ = true; }
+        bool is_failed() const { return failed_; }
+
+    protected:
+        bool failed_{false};
+    };
+
+    class PollingComponent : public Component
+    {
+    public:
+        PollingComponent() = default;
+        explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+        virtual void update() = 0;
+
+    protected:
+        uint32_t update_interval_{0};
+    };
+} // namespace esphome
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// millis() runs on the replay's virtual clock (see host.h), so debounce, pacing and
+// playout behave the same on every run. micros() is the real host clock: the stage
+// timers built into the components then measure actual CPU time per stage.
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+namespace esphome
+{
+    using ::delay;
+    using ::micros;
+    using ::millis;
+} // namespace esphome
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace esphome
+{
+    std::string format_hex_pretty(const uint8_t *data, size_t length);
+
+    template <typename T, typename... Args> std::unique_ptr<T> make_unique(Args &&...args)
+    {
+        return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
+    }
+
+    struct nullopt_t
+    {
+    };
+    constexpr nullopt_t nullopt{};
+
+    template <typename T> class optional
+    {
+    public:
+        optional() = default;
+        optional(nullopt_t) {}
+        optional(const T &value) : value_(value), has_value_(true) {}
+
+        bool has_value() const { return has_value_; }
+        explicit operator bool() const { return has_value_; }
+        const T &value() const { return value_; }
+        const T &operator*() const { return value_; }
+        T &operator*() { return value_; }
+        const T *operator->() const { return &value_; }
+
+    private:
+        T value_{};
+        bool has_value_{false};
+    };
+} // namespace esphome
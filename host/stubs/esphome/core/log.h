@@ -0,0 +1,43 @@
+#pragma once
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+// Same default as a device build; verbose-only code (hex dumps) is compiled out unless
+// the host build is configured with -DESPHOME_LOG_LEVEL=6, just like in the firmware
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_DEBUG
+#endif
+
+namespace esphome
+{
+    // Prints when `level` is within the runtime level set by the replay (host::set_log_level)
+    void host_log(int level, const char *tag, int line, const char *format, ...);
+} // namespace esphome
+
+#define ESPHOME_HOST_LOG(level, tag, ...) ::esphome::host_log(level, tag, __LINE__, __VA_ARGS__)
+
+#define ESP_LOGE(tag, ...) ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+#define ESP_LOGV(tag, ...) ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#else
+// Compiled out, but the arguments still count as used (no -Wunused-variable for values
+// that only feed a verbose log)
+#define ESP_LOGV(tag, ...)                                          \
+    do                                                              \
+    {                                                               \
+        if (false)                                                  \
+            ESPHOME_HOST_LOG(ESPHOME_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__); \
+    } while (0)
+#endif
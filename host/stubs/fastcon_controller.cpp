@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include "esphome/core/log.h"
+#include "fastcon_controller.h"
+
+namespace esphome
+{
+    namespace fastcon
+    {
+        static const char *const TAG = "fastcon.controller";
+
+        static uint8_t to_byte(float value, float scale)
+        {
+            return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * scale));
+        }
+
+        void FastconController::set_max_queue_size(size_t size)
+        {
+            max_queue_size_ = std::min(size, QUEUE_CAPACITY);
+        }
+
+        void FastconController::loop()
+        {
+            uint32_t now = millis();
+            if (queue_count_ == 0 || static_cast<int32_t>(now - busy_until_) < 0)
+                return;
+
+            Advert &advert = queue_[queue_head_];
+            queue_head_ = (queue_head_ + 1) % QUEUE_CAPACITY;
+            queue_count_--;
+
+            // The duration in effect when the advert starts is the one it goes out with
+            advert.on_air_at = now;
+            advert.duration_ms = adv_duration_;
+            busy_until_ = now + adv_duration_ + adv_gap_;
+            aired_++;
+            if (on_air_)
+                on_air_(advert);
+        }
+
+        std::vector<uint8_t> FastconController::get_light_data(light::LightState *state)
+        {
+            std::vector<uint8_t> out;
+            get_light_data(state, out);
+            return out;
+        }
+
+        // Same layout as the fork: on bit + 7-bit brightness, then blue, red, green, warm, cold
+        void FastconController::get_light_data(light::LightState *state, std::vector<uint8_t> &out)
+        {
+            const auto &values = state->current_values;
+            bool on = values.get_state() > 0.0f;
+            uint8_t brightness = on ? std::max<uint8_t>(to_byte(values.get_brightness(), 127.0f), 1) : 0;
+
+            out.clear();
+            out.push_back((on ? 0x80 : 0x00) | brightness);
+            if (!on)
+                return;
+
+            switch (values.get_color_mode())
+            {
+            case light::ColorMode::RGB:
+            case light::ColorMode::RGB_WHITE:
+                out.push_back(to_byte(values.get_blue(), 255.0f));
+                out.push_back(to_byte(values.get_red(), 255.0f));
+                out.push_back(to_byte(values.get_green(), 255.0f));
+                out.push_back(0);
+                out.push_back(0);
+                break;
+            case light::ColorMode::WHITE:
+            case light::ColorMode::COLD_WARM_WHITE:
+            case light::ColorMode::COLOR_TEMPERATURE:
+                out.push_back(0);
+                out.push_back(0);
+                out.push_back(0);
+                out.push_back(to_byte(values.get_warm_white(), 255.0f));
+                out.push_back(to_byte(values.get_cold_white(), 255.0f));
+                break;
+            default:
+                break;
+            }
+        }
+
+        std::vector<uint8_t> FastconController::single_control(uint32_t addr, const std::vector<uint8_t> &light_info)
+        {
+            std::vector<uint8_t> out;
+            single_control(addr, light_info, out);
+            return out;
+        }
+
+        void FastconController::single_control(uint32_t addr, const std::vector<uint8_t> &light_info, std::vector<uint8_t> &out)
+        {
+            single_control_calls_++;
+            size_t len = std::min(light_info.size(), LightData::CAPACITY);
+
+            out.assign(ADVERT_SIZE, 0);
+            out[0] = ADVERT_MAGIC;
+            for (size_t i = 0; i < 4; i++)
+                out[1 + i] = (addr >> (8 * i)) & 0xFF;
+            out[5] = static_cast<uint8_t>(len);
+            std::copy(light_info.begin(), light_info.begin() + len, out.begin() + 6);
+            // Stand-in for the ciphertext, so a mesh key change still changes the advert
+            for (size_t i = 6 + len; i < SEQUENCE_INDEX; i++)
+                out[i] = mesh_key_[i % 4] ^ static_cast<uint8_t>(i);
+            out[SEQUENCE_INDEX] = sequence_++;
+        }
+
+        void FastconController::restamp_sequence(std::vector<uint8_t> &adv)
+        {
+            if (adv.size() == ADVERT_SIZE && adv[0] == ADVERT_MAGIC)
+                adv[SEQUENCE_INDEX] = sequence_++;
+        }
+
+        bool FastconController::decode(const AdvPayload &adv, uint32_t &addr, LightData &light_data, uint8_t &sequence) const
+        {
+            if (adv.size() != ADVERT_SIZE || adv[0] != ADVERT_MAGIC || adv[5] > LightData::CAPACITY)
+                return false;
+            // A light on the current key can't read an advert built with another one
+            for (size_t i = 6 + adv[5]; i < SEQUENCE_INDEX; i++)
+            {
+                if (adv[i] != (mesh_key_[i % 4] ^ static_cast<uint8_t>(i)))
+                    return false;
+            }
+            addr = adv[1] | (adv[2] << 8) | (adv[3] << 16) | (static_cast<uint32_t>(adv[4]) << 24);
+            light_data.assign(adv.data() + 6, adv[5]);
+            sequence = adv[SEQUENCE_INDEX];
+            return true;
+        }
+
+        void FastconController::queueCommand(uint32_t light_id, const std::vector<uint8_t> &data)
+        {
+            push_(light_id, false, data);
+        }
+
+        void FastconController::send_raw_command(uint32_t addr, const std::vector<uint8_t> &data)
+        {
+            push_(addr, true, data);
+        }
+
+        void FastconController::push_(uint32_t addr, bool raw, const std::vector<uint8_t> &data)
+        {
+            if (queue_count_ >= max_queue_size_)
+            {
+                ESP_LOGW(TAG, "Command queue full, dropping command");
+                dropped_++;
+                return;
+            }
+            Advert &advert = queue_[(queue_head_ + queue_count_) % QUEUE_CAPACITY];
+            advert.addr = addr;
+            advert.raw = raw;
+            advert.data.assign(data);
+            queue_count_++;
+        }
+    } // namespace fastcon
+} // namespace esphome
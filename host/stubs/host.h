@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "IPAddress.h"
+
+// Controls for the host stand-ins of the device APIs, used by the replay drivers
+namespace host
+{
+    // Virtual clock behind millis(). Only the replay and blocking waits (i2s_read(),
+    // vTaskDelay(), delay()) move it, so a replay behaves the same on every machine.
+    uint32_t now_ms();
+    void advance_ms(uint32_t ms);
+
+    // ESP_LOG* output at or below `level` (ESPHOME_LOG_LEVEL_*), default WARN
+    void set_log_level(int level);
+
+    // Heap operations since start, counted in operator new/delete
+    struct AllocStats
+    {
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+    AllocStats alloc_stats();
+
+    // Microphone: sample `index` (from 0 at i2s_driver_install()) as a signed 32-bit value
+    using SampleSource = std::function<int32_t(uint64_t index)>;
+    void set_i2s_source(SampleSource source);
+    uint64_t i2s_samples_read();
+    uint64_t i2s_samples_lost();            // Overwritten before they were read (DMA overrun)
+
+    // Network: datagrams the components send go to the sink; injected ones are received in
+    // delivery order once their time has come
+    using DatagramSink = std::function<void(uint32_t at_ms, const IPAddress &to, const uint8_t *data, size_t len)>;
+    void set_udp_sink(DatagramSink sink);
+    void inject_datagram(uint32_t deliver_at_ms, const IPAddress &from, const uint8_t *data, size_t len);
+    size_t datagrams_pending();
+    void set_wifi_connected(bool connected);
+} // namespace host
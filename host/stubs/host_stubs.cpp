@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include "Arduino.h"
+#include "WiFi.h"
+#include "WiFiUdp.h"
+#include "driver/i2s.h"
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "host.h"
+
+namespace
+{
+    uint32_t virtual_ms = 0;
+    int log_level = ESPHOME_LOG_LEVEL_WARN;
+
+    struct I2SState
+    {
+        bool installed{false};
+        uint32_t installed_at{0};
+        uint32_t sample_rate{0};
+        uint64_t dma_buf_len{1};
+        uint64_t dma_capacity{0};
+        uint64_t consumed{0};
+        uint64_t lost{0};
+        host::SampleSource source;
+    } i2s;
+
+    struct Datagram
+    {
+        uint32_t deliver_at;
+        IPAddress from;
+        std::vector<uint8_t> data;
+    };
+    std::vector<Datagram> inbox;                // Sorted by delivery time
+    size_t inbox_next = 0;
+    host::DatagramSink udp_sink;
+    bool wifi_connected = true;
+
+    // Samples in DMA buffers that have completely filled by now
+    uint64_t i2s_completed(uint32_t now)
+    {
+        uint64_t produced = static_cast<uint64_t>(now - i2s.installed_at) * i2s.sample_rate / 1000;
+        return produced - produced % i2s.dma_buf_len;
+    }
+
+    // The DMA overwrites the oldest buffer once all of them are full
+    void i2s_overrun(uint64_t completed)
+    {
+        if (completed - i2s.consumed > i2s.dma_capacity)
+        {
+            uint64_t keep_from = completed - i2s.dma_capacity;
+            i2s.lost += keep_from - i2s.consumed;
+            i2s.consumed = keep_from;
+        }
+    }
+} // namespace
+
+uint32_t millis() { return virtual_ms; }
+
+uint32_t micros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+void delay(uint32_t ms) { host::advance_ms(ms); }
+
+BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *name, uint32_t, void *, int, TaskHandle_t *handle,
+                                   BaseType_t)
+{
+    ESP_LOGE("host", "Task '%s' not started, the host build is single threaded", name);
+    if (handle != nullptr)
+        *handle = nullptr;
+    return pdFAIL;
+}
+
+BaseType_t xPortGetCoreID() { return 1; }
+
+void vTaskDelay(TickType_t ticks) { host::advance_ms(ticks); }
+
+String IPAddress::toString() const
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2], bytes_[3]);
+    return String(buf);
+}
+
+WiFiClass WiFi;
+
+int WiFiClass::status() { return wifi_connected ? WL_CONNECTED : WL_DISCONNECTED; }
+
+uint8_t WiFiUDP::begin(uint16_t) { return 1; }
+
+uint8_t WiFiUDP::beginMulticast(IPAddress, uint16_t) { return 1; }
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t)
+{
+    tx_to_ = ip;
+    tx_len_ = 0;
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *data, size_t len)
+{
+    len = std::min(len, sizeof(tx_) - tx_len_);
+    memcpy(tx_ + tx_len_, data, len);
+    tx_len_ += len;
+    return len;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (udp_sink)
+        udp_sink(virtual_ms, tx_to_, tx_, tx_len_);
+    tx_len_ = 0;
+    return 1;
+}
+
+int WiFiUDP::parsePacket()
+{
+    rx_len_ = rx_pos_ = 0;
+    if (inbox_next == inbox.size() || static_cast<int32_t>(virtual_ms - inbox[inbox_next].deliver_at) < 0)
+        return 0;
+    const Datagram &datagram = inbox[inbox_next++];
+    rx_len_ = std::min(datagram.data.size(), sizeof(rx_));
+    memcpy(rx_, datagram.data.data(), rx_len_);
+    rx_from_ = datagram.from;
+    return static_cast<int>(rx_len_);
+}
+
+int WiFiUDP::read(uint8_t *buf, size_t len)
+{
+    len = std::min(len, rx_len_ - rx_pos_);
+    memcpy(buf, rx_ + rx_pos_, len);
+    rx_pos_ += len;
+    return static_cast<int>(len);
+}
+
+esp_err_t i2s_driver_install(i2s_port_t, const i2s_config_t *config, int, void *)
+{
+    i2s.installed = true;
+    i2s.installed_at = virtual_ms;
+    i2s.sample_rate = config->sample_rate;
+    i2s.dma_buf_len = std::max(config->dma_buf_len, 1);
+    i2s.dma_capacity = i2s.dma_buf_len * config->dma_buf_count;
+    i2s.consumed = 0;
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t, const i2s_pin_config_t *) { return ESP_OK; }
+
+esp_err_t i2s_read(i2s_port_t, void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait)
+{
+    *bytes_read = 0;
+    if (!i2s.installed)
+        return ESP_FAIL;
+
+    uint64_t wanted = size / sizeof(int32_t);
+    uint32_t waited = 0;
+    while (true)
+    {
+        uint64_t completed = i2s_completed(virtual_ms);
+        i2s_overrun(completed);
+        if (completed - i2s.consumed >= wanted)
+            break;
+
+        // Block until enough DMA buffers have filled, or the timeout runs out
+        uint64_t needed = i2s.consumed + wanted;
+        needed += (i2s.dma_buf_len - needed % i2s.dma_buf_len) % i2s.dma_buf_len;
+        uint32_t ready_at = i2s.installed_at + static_cast<uint32_t>((needed * 1000 + i2s.sample_rate - 1) / i2s.sample_rate);
+        uint32_t wait = ready_at - virtual_ms;
+        if (ticks_to_wait != portMAX_DELAY)
+            wait = std::min(wait, ticks_to_wait - waited);
+        if (wait == 0)
+            break;
+        host::advance_ms(wait);
+        waited += wait;
+    }
+
+    uint64_t count = std::min(wanted, i2s_completed(virtual_ms) - i2s.consumed);
+    auto *out = static_cast<int32_t *>(dest);
+    for (uint64_t i = 0; i < count; i++)
+        out[i] = i2s.source ? i2s.source(i2s.consumed + i) : 0;
+    i2s.consumed += count;
+    *bytes_read = count * sizeof(int32_t);
+    return ESP_OK;
+}
+
+namespace esphome
+{
+    Application App;
+
+    void Application::setup()
+    {
+        // Highest priority first, registration order within a priority
+        std::stable_sort(components_.begin(), components_.end(), [](Component *a, Component *b)
+                         { return a->get_setup_priority() > b->get_setup_priority(); });
+        for (size_t i = 0; i < components_.size(); i++)
+            components_[i]->setup();
+    }
+
+    void Application::loop()
+    {
+        for (size_t i = 0; i < components_.size(); i++)
+        {
+            if (!components_[i]->is_failed())
+                components_[i]->loop();
+        }
+    }
+
+    void host_log(int level, const char *tag, int line, const char *format, ...)
+    {
+        if (level > log_level)
+            return;
+        static const char LETTERS[] = "NEWICDVV";
+        fprintf(stderr, "%7u [%c][%s:%d]: ", virtual_ms, LETTERS[level], tag, line);
+        va_list args;
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+
+    std::string format_hex_pretty(const uint8_t *data, size_t length)
+    {
+        std::string out;
+        char buf[4];
+        for (size_t i = 0; i < length; i++)
+        {
+            snprintf(buf, sizeof(buf), i == 0 ? "%02X" : ".%02X", data[i]);
+            out += buf;
+        }
+        return out + " (" + std::to_string(length) + ")";
+    }
+} // namespace esphome
+
+namespace host
+{
+    uint32_t now_ms() { return virtual_ms; }
+
+    void advance_ms(uint32_t ms) { virtual_ms += ms; }
+
+    void set_log_level(int level) { log_level = level; }
+
+    void set_i2s_source(SampleSource source) { i2s.source = std::move(source); }
+
+    uint64_t i2s_samples_read() { return i2s.consumed - i2s.lost; }
+
+    uint64_t i2s_samples_lost() { return i2s.lost; }
+
+    void set_udp_sink(DatagramSink sink) { udp_sink = std::move(sink); }
+
+    void inject_datagram(uint32_t deliver_at_ms, const IPAddress &from, const uint8_t *data, size_t len)
+    {
+        auto pos = std::upper_bound(inbox.begin() + inbox_next, inbox.end(), deliver_at_ms,
+                                    [](uint32_t at, const Datagram &d) { return at < d.deliver_at; });
+        inbox.insert(pos, Datagram{deliver_at_ms, from, std::vector<uint8_t>(data, data + len)});
+    }
+
+    size_t datagrams_pending() { return inbox.size() - inbox_next; }
+
+    void set_wifi_connected(bool connected) { wifi_connected = connected; }
+} // namespace host
@@ -12,6 +12,7 @@ import json
 import logging
 import os
 import sys
+import time
 from typing import Dict, List
 import paho.mqtt.client as mqtt
 from bleak import BleakScanner
@@ -32,12 +33,22 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+# Best-bridge election: a light only moves to another controller when that one's link
+# is clearly better, so two bridges with similar RSSI don't trade it back and forth
+RSSI_HYSTERESIS_DB = 6
+RSSI_STALE_SECONDS = 180  # Reports older than this no longer count for routing
+
 class BRMeshBridge:
     def __init__(self):
         # Initialize lights/controllers before loading config
         self.lights: Dict[int, dict] = {}
         self.controllers: List[dict] = []
         
+        # Live link quality: light_id -> controller name -> (rssi, time.monotonic() of report)
+        self.link_rssi: Dict[int, Dict[str, tuple]] = {}
+        # Controller each light's commands currently go through
+        self.light_routes: Dict[int, str] = {}
+        
         self.load_config()
         
         # Configuration from add-on options
@@ -191,7 +202,8 @@ class BRMeshBridge:
         
         # Subscribe to ESP32 controller status topics (birth messages)
         client.subscribe("brmesh-bridge/+/status")
-        logger.info("Subscribed to ESP32 controller status topics")
+        client.subscribe("brmesh-bridge/+/rssi")
+        logger.info("Subscribed to ESP32 controller status and RSSI topics")
         
         # Subscribe to command topics for all lights
         for light_id in self.lights:
@@ -210,6 +222,9 @@ class BRMeshBridge:
             if msg.topic.startswith("brmesh-bridge/") and msg.topic.endswith("/status"):
                 self.handle_controller_status(msg)
                 return
+            if msg.topic.startswith("brmesh-bridge/") and msg.topic.endswith("/rssi"):
+                self.handle_controller_rssi(msg.topic.split('/')[1], msg.payload.decode())
+                return
             
             # Parse topic to get light ID
             topic_parts = msg.topic.split('/')
@@ -278,6 +293,45 @@ class BRMeshBridge:
         except Exception as e:
             logger.error(f"Error handling controller status: {e}")
     
+    def handle_controller_rssi(self, controller_name: str, report: str):
+        """Store a controller's "Light RSSI" report ("id:rssi,id:rssi") and re-elect routes"""
+        now = time.monotonic()
+        for entry in report.split(','):
+            try:
+                light_id, rssi = entry.split(':')
+                light_id, rssi = int(light_id), int(rssi)
+            except ValueError:
+                continue
+            self.link_rssi.setdefault(light_id, {})[controller_name] = (rssi, now)
+            self.elect_bridge(light_id)
+    
+    def elect_bridge(self, light_id: int):
+        """Route a light through the online controller with the strongest fresh RSSI"""
+        now = time.monotonic()
+        offline = {c.get('name') for c in self.controllers if c.get('status') == 'offline'}
+        candidates = {
+            name: rssi for name, (rssi, seen) in self.link_rssi.get(light_id, {}).items()
+            if now - seen < RSSI_STALE_SECONDS and name not in offline
+        }
+        if not candidates:
+            # Keep the last route while it's still usable, never one through an offline bridge
+            current = self.light_routes.get(light_id)
+            if current in offline:
+                logger.info(f"Dropping route of light {light_id} via offline '{current}'")
+                del self.light_routes[light_id]
+                return None
+            return current
+        
+        best = max(candidates, key=candidates.get)
+        current = self.light_routes.get(light_id)
+        if current in candidates and candidates[best] < candidates[current] + RSSI_HYSTERESIS_DB:
+            return current
+        
+        if best != current:
+            logger.info(f"Routing light {light_id} via '{best}' ({candidates[best]} dBm)")
+            self.light_routes[light_id] = best
+        return best
+    
     def publish_discovery(self):
         """Publish Home Assistant MQTT discovery configs"""
         for light_id, light in self.lights.items():
@@ -365,18 +419,29 @@ class BRMeshBridge:
             0, 0, 0, 0  # padding
         )
         
-        logger.info(f"Would send BLE command to light {light_id}: {inner_payload.hex()}")
+        controller = self.elect_bridge(light_id)
+        logger.info(f"Would send BLE command to light {light_id} via {controller or 'any controller'}: {inner_payload.hex()}")
         # TODO: Implement actual BLE broadcast using bleak
     
     def get_controller_signal_map(self, controller_name: str) -> Dict:
         """Get signal strength from controller to all lights"""
-        # This would query the ESP32 via MQTT for RSSI values
-        # For now, return mock data
+        now = time.monotonic()
         signal_map = {}
         for light_id in self.lights.keys():
+            rssi, seen = self.link_rssi.get(light_id, {}).get(controller_name, (None, 0))
+            if rssi is None or now - seen >= RSSI_STALE_SECONDS:
+                quality = 'unknown'
+                rssi = None
+            elif rssi >= -65:
+                quality = 'good'
+            elif rssi >= -80:
+                quality = 'fair'
+            else:
+                quality = 'poor'
             signal_map[light_id] = {
-                'rssi': -60,  # Mock RSSI value
-                'quality': 'good'
+                'rssi': rssi,
+                'quality': quality,
+                'routed': self.light_routes.get(light_id) == controller_name
             }
         return signal_map
     